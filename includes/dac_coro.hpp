@@ -0,0 +1,518 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Backend implementation of the DAC pattern with C++20 coroutines.
+
+ Each node of the DAC tree is a coroutine: a parent co_awaits its children and is
+ suspended (its frame lives on the heap) until the last child completes, that resumes it.
+ No thread is ever blocked waiting for children, so the depth of the tree does not
+ translate into native stack usage or parked threads.
+ Coroutines are executed by a work-stealing executor. Its workers are created at the first computation
+ with a given parallelism degree and kept for the following ones; idle workers sleep on a condition variable.
+ The thread calling compute() waits for the end of the computation without taking part in it, so compute()
+ must not be called by the functions of a computation running with the same parallelism degree.
+
+ Besides the parallelism degree, the backend supports the maximum recursion depth, the memory budget, the spawn
+ policy (default: work first) and the size of the static probes (see dac_probes.hpp). The other options of
+ the OpenMP and TBB backends (batched leaves, reduction, ...) are not available: calling them does not compile.
+
+ Requires -std=c++20
+*/
+
+#ifndef DAC_CORO_HPP
+#define DAC_CORO_HPP
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <functional>
+#include <type_traits>
+#include <coroutine>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+#include "dac_sequential.hpp"
+#include "dac_explicit_stack.hpp"
+#include "dac_memory_budget.hpp"
+#include "dac_spawn_policy.hpp"
+#include "dac_probes.hpp"
+
+
+/**
+ * Work-stealing executor: each worker has its own deque of ready coroutines.
+ * The owner pushes and pops at the back (depth first), thieves steal from the front
+ * (where the biggest subproblems are). Coroutines made ready by other threads go to an additional queue
+ */
+class DacCoroExecutor{
+
+public:
+
+	DacCoroExecutor(int nworkers): _nworkers(nworkers>0?nworkers:1), _ready(0), _sleeping(0), _stop(false)
+	{
+		for(int i=0;i<=_nworkers;i++)
+			_queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+		for(int i=0;i<_nworkers;i++)
+			_workers.push_back(std::thread(&DacCoroExecutor::workerLoop,this,i));
+	}
+
+	~DacCoroExecutor()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop=true;
+		}
+		_work.notify_all();
+		for(std::thread &t:_workers)
+			t.join();
+	}
+
+	/**
+	 * @brief pool executor with nworkers workers shared by all the computations with that parallelism degree.
+	 * It is created at the first call, and its workers live until the end of the program (the pools are not
+	 * destroyed at exit: their workers would run the destructors of their thread locals after the static objects)
+	 */
+	static DacCoroExecutor& pool(int nworkers)
+	{
+		static std::mutex mutex;
+		static std::map<int,DacCoroExecutor*> *pools=new std::map<int,DacCoroExecutor*>();
+		std::lock_guard<std::mutex> lock(mutex);
+		DacCoroExecutor *&p=(*pools)[nworkers];
+		if(!p)
+			p=new DacCoroExecutor(nworkers);
+		return *p;
+	}
+
+	/**
+	 * @brief schedule makes a coroutine ready. It is inserted in the queue of the calling worker
+	 * (or in the one of the other threads if the caller is not a worker of this executor)
+	 */
+	void schedule(std::coroutine_handle<> h)
+	{
+		WorkerQueue &q=*_queues[_current==this ? _worker_id : _nworkers];
+		{
+			std::lock_guard<std::mutex> lock(q.lock);
+			q.tasks.push_back(h);
+		}
+		_ready.fetch_add(1);
+		if(_sleeping.load()>0)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_work.notify_one();
+		}
+	}
+
+	/**
+	 * @brief currentWorker index of the calling worker, -1 if the caller is not a worker of any executor
+	 */
+	static int currentWorker()
+	{
+		return _current ? _worker_id : -1;
+	}
+
+private:
+
+	struct WorkerQueue{
+		std::mutex lock;
+		std::deque<std::coroutine_handle<>> tasks;
+	};
+
+	void workerLoop(int id)
+	{
+		_current=this;
+		_worker_id=id;
+		while(true)
+		{
+			std::coroutine_handle<> h=pop(id);
+			for(int i=1;!h && i<=_nworkers;i++)
+				h=steal((id+i)%(_nworkers+1));
+			if(h)
+			{
+				h.resume();
+				continue;
+			}
+			//nothing to do: sleep until a coroutine is made ready
+			std::unique_lock<std::mutex> lock(_mutex);
+			_sleeping.fetch_add(1);
+			_work.wait(lock,[this]{ return _stop || _ready.load()>0; });
+			_sleeping.fetch_sub(1);
+			if(_stop)
+				break;
+		}
+		_current=nullptr;
+	}
+
+	std::coroutine_handle<> pop(int id)
+	{
+		WorkerQueue &q=*_queues[id];
+		std::lock_guard<std::mutex> lock(q.lock);
+		if(q.tasks.empty())
+			return nullptr;
+		std::coroutine_handle<> h=q.tasks.back();
+		q.tasks.pop_back();
+		_ready.fetch_sub(1);
+		return h;
+	}
+
+	std::coroutine_handle<> steal(int victim)
+	{
+		WorkerQueue &q=*_queues[victim];
+		std::lock_guard<std::mutex> lock(q.lock);
+		if(q.tasks.empty())
+			return nullptr;
+		std::coroutine_handle<> h=q.tasks.front();
+		q.tasks.pop_front();
+		_ready.fetch_sub(1);
+		return h;
+	}
+
+	int _nworkers;
+	std::vector<std::unique_ptr<WorkerQueue>> _queues;		//one per worker, the last one for the other threads
+	std::vector<std::thread> _workers;
+	std::atomic<long> _ready;		//coroutines in the queues
+	std::atomic<int> _sleeping;		//workers waiting for _work
+	bool _stop;
+	std::mutex _mutex;
+	std::condition_variable _work;
+	static inline thread_local DacCoroExecutor *_current=nullptr;
+	static inline thread_local int _worker_id=-1;
+};
+
+
+//end of a computation, signaled by its root to the thread waiting in compute()
+struct DacCoroDone{
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool done=false;
+
+	void signal()
+	{
+		//notified under the lock: the waiter can not return (and destroy this) before the notification
+		std::lock_guard<std::mutex> lock(mutex);
+		done=true;
+		cv.notify_one();
+	}
+
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock,[this]{ return done; });
+	}
+};
+
+//false for any argument: static_assert of the options not available with coroutines
+template<typename... Args>
+struct DacCoroUnsupported: std::false_type{};
+
+
+
+template<typename OperandType,typename ResultType>
+class DacCoro{
+
+public:
+
+	DacCoro(const std::function<void(const OperandType&,std::vector<OperandType>&)>& divide_fn,
+			  const std::function<void(std::vector<ResultType>&,ResultType&)>& combine_fn,
+			  const std::function<void(const OperandType&, ResultType&)>& seq_fn,
+			  const std::function<bool(const OperandType&)>& cond_fn, const OperandType& op, ResultType& res, int pardegree):
+				_divide_fn(divide_fn), _combine_fn(combine_fn), _seq_fn(seq_fn), _condition_fn(cond_fn), _op(&op), _res(&res), _pardegree(pardegree), _max_depth(DAC_MAX_RECURSION_DEPTH), _spawn_policy(DAC_WORK_FIRST), _hybrid_depth(0)
+	{}
+
+	/**
+	 * @brief setMaxRecursionDepth nodes deeper than depth are solved by the worker that reaches them
+	 * using an explicit stack, instead of creating a coroutine per node. <=0: no limit
+	 */
+	void setMaxRecursionDepth(int depth)
+	{
+		_max_depth=depth;
+	}
+
+	/**
+	 * @brief setMemoryBudget limits the memory used by the temporaries of the nodes being solved in parallel.
+	 * mem_fn estimates the temporaries (subproblems and partial results) of a non-leaf node: when they would
+	 * exceed budget bytes the node is solved depth first, without creating coroutines
+	 */
+	void setMemoryBudget(size_t budget, const std::function<size_t(const OperandType&)>& mem_fn)
+	{
+		_mem_budget.setBudget(budget);
+		_mem_fn=mem_fn;
+	}
+
+	/**
+	 * @brief setSpawnPolicy how the children of a node are scheduled (see dac_spawn_policy.hpp). Default: work first,
+	 * the last child is resumed directly by the worker of the parent. With DAC_HYBRID nodes at depth<hybrid_depth
+	 * are help first, the others work first
+	 */
+	void setSpawnPolicy(DacSpawnPolicy policy, int hybrid_depth=0)
+	{
+		_spawn_policy=policy;
+		_hybrid_depth=hybrid_depth;
+	}
+
+	/**
+	 * @brief setProbeSize size_fn(op) gives the size of an operand reported by the static probes (see dac_probes.hpp).
+	 * It is called only if the program is compiled with DAC_USDT, while a tracer is attached to the probe
+	 */
+	void setProbeSize(const std::function<long(const OperandType&)>& size_fn)
+	{
+		_probe_size_fn=size_fn;
+	}
+
+	//options of the OpenMP and TBB backends that are not available with coroutines
+	template<typename... Args>
+	void setBatchedLeaves(Args&&...) { static_assert(DacCoroUnsupported<Args...>::value,"DacCoro: batched leaves are not supported"); }
+	template<typename... Args>
+	void setReduction(Args&&...) { static_assert(DacCoroUnsupported<Args...>::value,"DacCoro: reduction mode is not supported"); }
+	template<typename... Args>
+	void setPartialCombine(Args&&...) { static_assert(DacCoroUnsupported<Args...>::value,"DacCoro: partial combine is not supported"); }
+	template<typename... Args>
+	void setWorkSpanAnalysis(Args&&...) { static_assert(DacCoroUnsupported<Args...>::value,"DacCoro: work span analysis is not supported"); }
+	template<typename... Args>
+	void setElastic(Args&&...) { static_assert(DacCoroUnsupported<Args...>::value,"DacCoro: elastic mode is not supported"); }
+	template<typename... Args>
+	void setLazySplitting(Args&&...) { static_assert(DacCoroUnsupported<Args...>::value,"DacCoro: lazy splitting is not supported"); }
+	template<typename... Args>
+	void setDependencies(Args&&...) { static_assert(DacCoroUnsupported<Args...>::value,"DacCoro: dependencies among children are not supported"); }
+	template<typename... Args>
+	void setIncremental(Args&&...) { static_assert(DacCoroUnsupported<Args...>::value,"DacCoro: incremental mode is not supported"); }
+	template<typename... Args>
+	void setSchedule(Args&&...) { static_assert(DacCoroUnsupported<Args...>::value,"DacCoro: recorded schedules are not supported"); }
+
+	void compute()
+	{
+		DAC_PROBE1(compute_start,_pardegree);
+		if(_pardegree==1)
+		{
+			//a single worker: plain sequential recursion, without the parallel runtime
+			computeSequential();
+			DAC_PROBE0(compute_end);
+			return;
+		}
+
+		_executor=&DacCoroExecutor::pool(_pardegree);
+		DacCoroDone done;
+
+		//the root signals the end of the computation instead of resuming a parent
+		Node root=recursiveDac(_op,_res,0,-1);
+		root.handle.promise().done=&done;
+		_executor->schedule(root.handle);
+		done.wait();
+
+		_executor=nullptr;
+		DAC_PROBE0(compute_end);
+	}
+
+
+private:
+
+	void computeSequential()
+	{
+		DacSequential<OperandType,ResultType> dac(_divide_fn,_combine_fn,_seq_fn,_condition_fn,*_op,*_res);
+		dac.setMaxRecursionDepth(_max_depth);
+		dac.compute();
+	}
+
+	struct Node;
+
+	struct FinalAwaiter{
+		bool await_ready() noexcept { return false; }
+		template<typename Promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+		{
+			Promise &p=h.promise();
+			if(p.done)
+			{
+				//the frame can be destroyed as soon as the waiter is signaled: it is not accessed anymore
+				p.done->signal();
+				return std::noop_coroutine();
+			}
+			//the last child that completes resumes the parent on this worker
+			if(p.pending->fetch_sub(1,std::memory_order_acq_rel)==1)
+				return p.parent;
+			return std::noop_coroutine();
+		}
+		void await_resume() noexcept {}
+	};
+
+	struct promise_type_base{
+		std::coroutine_handle<> parent;
+		std::atomic<int> *pending=nullptr;		//children of the parent not yet completed
+		DacCoroDone *done=nullptr;				//set only for the root
+
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		FinalAwaiter final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+
+	//a DAC node: it owns the coroutine frame, that is destroyed once the node has completed
+	struct Node{
+		struct promise_type: public promise_type_base{
+			Node get_return_object() { return Node(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		};
+
+		explicit Node(std::coroutine_handle<promise_type> h): handle(h) {}
+		Node(Node &&n) noexcept : handle(n.handle) { n.handle=nullptr; }
+		Node(const Node&)=delete;
+		~Node()
+		{
+			if(handle)
+				handle.destroy();
+		}
+
+		std::coroutine_handle<promise_type> handle;
+	};
+
+	//suspends the parent and schedules the children. Work first: the last one is run directly on this worker
+	struct JoinAwaiter{
+		std::vector<Node> &children;
+		std::atomic<int> &pending;
+		DacCoroExecutor &executor;
+		bool inline_last;
+
+		bool await_ready() { return children.empty(); }
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> parent)
+		{
+			int n=children.size();
+			bool run_last=inline_last;
+			pending.store(n,std::memory_order_relaxed);
+			for(int i=0;i<n;i++)
+			{
+				children[i].handle.promise().parent=parent;
+				children[i].handle.promise().pending=&pending;
+			}
+			if(run_last)
+			{
+				for(int i=0;i<n-1;i++)
+					executor.schedule(children[i].handle);
+				//the last child has not started yet: the parent can not be resumed and its frame is still valid
+				return children[n-1].handle;
+			}
+			//once the last child is scheduled the parent may be resumed by another worker: only locals are used
+			DacCoroExecutor &e=executor;
+			std::vector<std::coroutine_handle<>> handles;
+			handles.reserve(n);
+			for(int i=0;i<n;i++)
+				handles.push_back(children[i].handle);
+			for(std::coroutine_handle<> h:handles)
+				e.schedule(h);
+			return std::noop_coroutine();
+		}
+		void await_resume() {}
+	};
+
+	//spawner: worker that created the node, to detect steals (-1 for the root)
+	Node recursiveDac(const OperandType *op, ResultType *ret, int depth, int spawner)
+	{
+		probeTaskStarted(spawner,depth,*op);
+		size_t mem=0;
+		if((_max_depth>0 && depth>=_max_depth) || !reserveMemory(op,mem))
+		{
+			//too deep or over the memory budget: go on depth first, without coroutines
+			DAC_PROBE2(subtree_start,depth,probeSize(*op));
+			DacExplicitStack<OperandType,ResultType> stack(_divide_fn,_combine_fn,_seq_fn,_condition_fn);
+			stack.compute(op,ret);
+			DAC_PROBE2(subtree_end,depth,probeSize(*op));
+		}
+		else if(!_condition_fn(*op)) //not the base case
+		{
+			//divide
+			std::vector<OperandType> ops;
+			_divide_fn(*op,ops);
+			int branch_factor=ops.size();
+
+			//create the space for the partial results
+			std::vector<ResultType> ress(branch_factor);
+
+			//create the children (suspended) and wait for them
+			bool inline_last=dacInlineLastChild(_spawn_policy,_hybrid_depth,depth);
+			int worker=DacCoroExecutor::currentWorker();
+			std::vector<Node> children;
+			children.reserve(branch_factor);
+			for(int i=0;i<branch_factor;i++)
+			{
+				if(!inline_last || i<branch_factor-1)
+					DAC_PROBE2(spawn,depth+1,probeSize(ops[i]));
+				children.push_back(recursiveDac(&ops[i],&ress[i],depth+1,worker));
+			}
+			std::atomic<int> pending;
+			co_await JoinAwaiter{children,pending,*_executor,inline_last};
+			children.clear();
+
+			//combine results
+			DAC_PROBE2(combine_start,depth,probeSize(*op));
+			_combine_fn(ress,*ret);
+			DAC_PROBE2(combine_end,depth,probeSize(*op));
+			if(mem>0)
+				_mem_budget.release(mem);
+		}
+		else
+		{
+			DAC_PROBE2(leaf_start,depth,probeSize(*op));
+			_seq_fn(*op,*ret);
+			DAC_PROBE2(leaf_end,depth,probeSize(*op));
+		}
+	}
+
+	//reserve the memory of the temporaries of a non-leaf node: false if this would exceed the budget
+	bool reserveMemory(const OperandType *op, size_t &mem)
+	{
+		if(!_mem_fn || _condition_fn(*op))
+			return true;
+		mem=_mem_fn(*op);
+		return _mem_budget.reserve(mem);
+	}
+
+	long probeSize(const OperandType &op) const
+	{
+		return _probe_size_fn ? _probe_size_fn(op) : 0;
+	}
+
+	void probeTaskStarted(int spawner, int depth, const OperandType &op)
+	{
+#if DAC_USDT
+		if(spawner>=0 && spawner!=DacCoroExecutor::currentWorker())
+			DAC_PROBE2(steal,depth,probeSize(op));
+#else
+		(void)spawner;
+		(void)depth;
+		(void)op;
+#endif
+	}
+
+	//function pointers
+	const std::function<void(const OperandType&,std::vector<OperandType>&)>& _divide_fn;
+	const std::function<void(std::vector<ResultType>&,ResultType&)>& _combine_fn;
+	const std::function<void(const OperandType& ,  ResultType&)>& _seq_fn;
+	const std::function<bool(const OperandType&)>& _condition_fn;
+	const OperandType* _op;
+	ResultType* _res;
+
+	int _pardegree;
+	int _max_depth;
+	DacMemoryBudget _mem_budget;
+	std::function<size_t(const OperandType&)> _mem_fn;
+	DacSpawnPolicy _spawn_policy;
+	int _hybrid_depth;
+	std::function<long(const OperandType&)> _probe_size_fn;
+	DacCoroExecutor *_executor=nullptr;
+};
+
+#endif // DAC_CORO_HPP
@@ -0,0 +1,91 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Dependencies among the children of a node.
+
+ By default the children of a node are independent. Cache-oblivious dynamic programming
+ (edit distance, LCS, ...) or recursive triangular solves need children that depend on
+ their siblings: e.g. quadrant (1,2) can start only once quadrant (1,1) has been solved.
+ A dependence function declares, for each child, the siblings that must be completed before it
+ starts; the backends then schedule the children of a node as a small DAG, starting each child
+ as soon as its last predecessor has completed.
+
+ Children must be produced in a topological order (predecessors have smaller indexes): the
+ sequential and depth first executions solve them in index order.
+*/
+
+#ifndef DAC_DAG_HPP
+#define DAC_DAG_HPP
+
+#include <vector>
+#include <atomic>
+
+class DacDag{
+
+public:
+
+	/**
+	 * @param preds for each child, the indexes of the children that must be completed before it
+	 */
+	DacDag(const std::vector<std::vector<int>> &preds):
+		_preds(preds), _missing(preds.size()), _succ(preds.size())
+	{
+		for(size_t i=0;i<preds.size();i++)
+		{
+			_missing[i].store(preds[i].size(),std::memory_order_relaxed);
+			if(preds[i].empty())
+				_roots.push_back(i);
+			for(int p:preds[i])
+				_succ[p].push_back(i);
+		}
+	}
+
+	/**
+	 * @brief roots the children without predecessors
+	 */
+	const std::vector<int>& roots() const
+	{
+		return _roots;
+	}
+
+	const std::vector<std::vector<int>>& preds() const
+	{
+		return _preds;
+	}
+
+	/**
+	 * @brief completed called when a child has been solved: ready receives the children
+	 * whose last predecessor was it
+	 */
+	void completed(int child, std::vector<int> &ready)
+	{
+		for(int s:_succ[child])
+		{
+			if(_missing[s].fetch_sub(1,std::memory_order_acq_rel)==1)
+				ready.push_back(s);
+		}
+	}
+
+private:
+	std::vector<std::vector<int>> _preds;
+	std::vector<std::atomic<int>> _missing;		//predecessors not yet completed
+	std::vector<std::vector<int>> _succ;
+	std::vector<int> _roots;
+};
+
+#endif // DAC_DAG_HPP
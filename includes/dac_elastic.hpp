@@ -0,0 +1,193 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Elastic number of workers, for hosts shared with other applications.
+
+ During a computation a monitor thread periodically reads the number of runnable threads of the
+ host (procs_running in /proc/stat), subtracts the ones of this process (the workers, also the idle
+ ones spinning in the runtime, are runnable) and sets the number of active workers to the cores left
+ free by the other applications, within [min,max].
+ The backends spawn a child only if the running tasks leave room for it, otherwise the child is solved
+ inline by its parent (and its own children are spawned as soon as there is room again). A task waiting
+ for its children is not running: the backends call waitStarted/waitEnded around the wait. Exceeding
+ workers find no tasks and sleep in the runtime, instead of competing for the cores; no worker is ever
+ suspended while holding a task.
+*/
+
+#ifndef DAC_ELASTIC_HPP
+#define DAC_ELASTIC_HPP
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <dirent.h>
+
+#define DAC_ELASTIC_PERIOD_MSECS 10
+
+class DacElasticMonitor{
+
+public:
+
+	DacElasticMonitor(int min_workers, int max_workers):
+		_min(std::max(min_workers,1)), _max(std::max(max_workers,std::max(min_workers,1))), _active(_max), _stop(false)
+	{
+		int cores=std::thread::hardware_concurrency();
+		_cores=(cores>0?cores:_max);
+	}
+
+	~DacElasticMonitor()
+	{
+		stop();
+	}
+
+	void start()
+	{
+		_stop=false;
+		_active.store(_max,std::memory_order_relaxed);
+		_running.store(1,std::memory_order_relaxed);		//the thread that started the computation
+		_monitor=std::thread(&DacElasticMonitor::monitor,this);
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop=true;
+		}
+		_cond.notify_all();
+		if(_monitor.joinable())
+			_monitor.join();
+	}
+
+	/**
+	 * @brief acquireTask true if a task can be spawned: the running tasks (counting the thread that started
+	 * the computation) would not exceed the active workers. The task must call releaseTask at its end
+	 */
+	bool acquireTask()
+	{
+		int running=_running.load(std::memory_order_relaxed);
+		do{
+			if(running>=_active.load(std::memory_order_relaxed))
+				return false;
+		}while(!_running.compare_exchange_weak(running,running+1,std::memory_order_relaxed));
+		return true;
+	}
+
+	void releaseTask()
+	{
+		_running.fetch_sub(1,std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief waitStarted the calling task (or the thread that started the computation) waits for its
+	 * children: it is not running until waitEnded
+	 */
+	void waitStarted()
+	{
+		_running.fetch_sub(1,std::memory_order_relaxed);
+	}
+
+	void waitEnded()
+	{
+		_running.fetch_add(1,std::memory_order_relaxed);
+	}
+
+	int activeWorkers() const
+	{
+		return _active.load(std::memory_order_relaxed);
+	}
+
+private:
+
+	//runnable threads of the host, -1 if not available
+	static int runnableThreads()
+	{
+		std::ifstream stat("/proc/stat");
+		std::string key;
+		long value;
+		while(stat >> key)
+		{
+			if(key=="procs_running" && stat >> value)
+				return value;
+			stat.ignore(1<<20,'\n');
+		}
+		return -1;
+	}
+
+	//running threads of this process (state R in /proc/self/task/<tid>/stat), -1 if not available
+	static int ownRunningThreads()
+	{
+		DIR *dir=opendir("/proc/self/task");
+		if(dir==nullptr)
+			return -1;
+		int running=0;
+		while(dirent *entry=readdir(dir))
+		{
+			if(entry->d_name[0]=='.')
+				continue;
+			std::ifstream stat(std::string("/proc/self/task/")+entry->d_name+"/stat");
+			std::string line;
+			std::getline(stat,line);
+			//the state follows the name of the thread, in parentheses
+			size_t name_end=line.rfind(')');
+			if(name_end!=std::string::npos && name_end+2<line.size() && line[name_end+2]=='R')
+				running++;
+		}
+		closedir(dir);
+		return running;
+	}
+
+	void monitor()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		while(!_stop)
+		{
+			lock.unlock();
+			int running=runnableThreads();
+			if(running>=0)
+			{
+				//runnable threads of the other applications. Without /proc/self/task: the running tasks and
+				//the monitor itself (idle workers spinning in the runtime are then taken for other applications)
+				int own=ownRunningThreads();
+				if(own<0)
+					own=std::min(_running.load(std::memory_order_relaxed),_max)+1;
+				int others=std::max(running-own,0);
+				_active.store(std::min(std::max(_cores-others,_min),_max),std::memory_order_relaxed);
+			}
+			lock.lock();
+			_cond.wait_for(lock,std::chrono::milliseconds(DAC_ELASTIC_PERIOD_MSECS),[this]{ return _stop; });
+		}
+	}
+
+	int _min;
+	int _max;
+	int _cores;
+	std::atomic<int> _active;
+	std::atomic<int> _running;		//tasks spawned and not yet completed, but the ones waiting for their children
+	bool _stop;
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	std::thread _monitor;
+};
+
+#endif // DAC_ELASTIC_HPP
@@ -0,0 +1,136 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Sequential, non recursive, execution of a DAC subtree.
+
+ Pending nodes are kept on an explicit (heap allocated) stack, so the native stack
+ usage does not depend on the depth of the tree. The backends switch to it once
+ a node is deeper than a given depth (DAC_MAX_RECURSION_DEPTH by default):
+ degenerate trees (e.g. quicksort with bad pivots) can not overflow the workers stacks.
+*/
+
+#ifndef DAC_EXPLICIT_STACK_HPP
+#define DAC_EXPLICIT_STACK_HPP
+
+#include <vector>
+#include <functional>
+
+//depth after which the backends stop recursing on the native stack (<=0: no limit)
+#ifndef DAC_MAX_RECURSION_DEPTH
+#define DAC_MAX_RECURSION_DEPTH 256
+#endif
+
+template<typename OperandType,typename ResultType>
+class DacExplicitStack{
+
+public:
+
+	DacExplicitStack(const std::function<void(const OperandType&,std::vector<OperandType>&)>& divide_fn,
+					 const std::function<void(std::vector<ResultType>&,ResultType&)>& combine_fn,
+					 const std::function<void(const OperandType&, ResultType&)>& seq_fn,
+					 const std::function<bool(const OperandType&)>& cond_fn):
+						_divide_fn(divide_fn), _combine_fn(combine_fn), _seq_fn(seq_fn), _condition_fn(cond_fn)
+	{}
+
+	~DacExplicitStack()
+	{
+		for(Frame *f:_stack)
+			delete f;
+		for(Frame *f:_free)
+			delete f;
+	}
+
+	/**
+	 * @brief compute solves (depth first) the subtree rooted in op
+	 */
+	void compute(const OperandType *op, ResultType *res)
+	{
+		if(_condition_fn(*op))
+		{
+			_seq_fn(*op,*res);
+			return;
+		}
+
+		push(op,res);
+		while(!_stack.empty())
+		{
+			Frame *f=_stack.back();
+			if(f->next<f->ops.size())
+			{
+				//go on with the next child
+				size_t i=f->next++;
+				if(_condition_fn(f->ops[i]))
+					_seq_fn(f->ops[i],f->ress[i]);
+				else
+					push(&f->ops[i],&f->ress[i]);
+			}
+			else
+			{
+				//all the children have been solved
+				_combine_fn(f->ress,*f->res);
+				_stack.pop_back();
+				release(f);
+			}
+		}
+	}
+
+private:
+
+	//a node whose children are being solved
+	struct Frame{
+		ResultType *res;
+		std::vector<OperandType> ops;
+		std::vector<ResultType> ress;
+		size_t next;		//next child to solve
+	};
+
+	void push(const OperandType *op, ResultType *res)
+	{
+		Frame *f;
+		if(_free.empty())
+			f=new Frame();
+		else
+		{
+			f=_free.back();
+			_free.pop_back();
+		}
+		f->res=res;
+		f->next=0;
+		_divide_fn(*op,f->ops);
+		f->ress.resize(f->ops.size());
+		_stack.push_back(f);
+	}
+
+	//frames (and their vectors) are reused by the following nodes
+	void release(Frame *f)
+	{
+		f->ops.clear();
+		f->ress.clear();
+		_free.push_back(f);
+	}
+
+	const std::function<void(const OperandType&,std::vector<OperandType>&)>& _divide_fn;
+	const std::function<void(std::vector<ResultType>&,ResultType&)>& _combine_fn;
+	const std::function<void(const OperandType& ,  ResultType&)>& _seq_fn;
+	const std::function<bool(const OperandType&)>& _condition_fn;
+
+	std::vector<Frame*> _stack;
+	std::vector<Frame*> _free;
+};
+
+#endif // DAC_EXPLICIT_STACK_HPP
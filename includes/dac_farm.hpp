@@ -0,0 +1,199 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Farm of DAC computations over a stream of independent problems (OpenMP backend).
+
+ Problems are taken from an input queue and each of them is solved by a DAC computation.
+ Up to max_inflight computations run at the same time on the same pool of workers,
+ so that the sequential phases at the top of a tree (e.g. the root divide) are
+ overlapped with the computation of other problems. Solved problems are delivered to
+ an output queue, in arrival or completion order.
+*/
+
+#ifndef DAC_FARM_HPP
+#define DAC_FARM_HPP
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <utility>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <omp.h>
+#include "dac_openmp.hpp"
+
+
+/**
+ * Unbounded blocking queue used for the input and output streams of the farm
+ */
+template<typename T>
+class DacQueue{
+
+public:
+
+	DacQueue(): _closed(false)
+	{}
+
+	void push(const T &item)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_items.push_back(item);
+		_not_empty.notify_one();
+	}
+
+	/**
+	 * @brief close signals the end of the stream
+	 */
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_closed=true;
+		_not_empty.notify_all();
+	}
+
+	/**
+	 * @brief pop waits for the next item
+	 * @return false if the stream is closed and there are no more items
+	 */
+	bool pop(T &item)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_not_empty.wait(lock,[this]{return !_items.empty() || _closed;});
+		if(_items.empty())
+			return false;
+		item=_items.front();
+		_items.pop_front();
+		return true;
+	}
+
+private:
+	std::mutex _mutex;
+	std::condition_variable _not_empty;
+	std::deque<T> _items;
+	bool _closed;
+};
+
+
+template<typename OperandType,typename ResultType>
+class DacFarm{
+
+public:
+
+	//a problem is identified by its operand and by the place where to store its result (both owned by the caller)
+	typedef std::pair<const OperandType*,ResultType*> Problem;
+
+	/**
+	 * @param input problems to solve, until the queue is closed
+	 * @param output solved problems. It is closed once all the problems have been solved
+	 * @param pardegree number of workers shared by all the computations
+	 * @param max_inflight maximum number of problems solved at the same time
+	 * @param ordered if true problems are delivered in arrival order, otherwise in completion order
+	 */
+	DacFarm(const std::function<void(const OperandType&,std::vector<OperandType>&)>& divide_fn,
+			  const std::function<void(std::vector<ResultType>&,ResultType&)>& combine_fn,
+			  const std::function<void(const OperandType&, ResultType&)>& seq_fn,
+			  const std::function<bool(const OperandType&)>& cond_fn, DacQueue<Problem>& input, DacQueue<Problem>& output,
+			  int pardegree, int max_inflight, bool ordered):
+				_divide_fn(divide_fn), _combine_fn(combine_fn), _seq_fn(seq_fn), _condition_fn(cond_fn), _input(input), _output(output),
+				_pardegree(pardegree), _max_inflight(max_inflight>0?max_inflight:1), _ordered(ordered), _inflight(0), _next_out(0)
+	{}
+
+	/**
+	 * @brief compute solves the problems of the input stream, it returns once the stream is closed
+	 * and all the problems have been delivered
+	 */
+	void compute()
+	{
+		long next_id=0;
+
+		//an additional thread receives the problems: it is blocked most of the time
+#pragma omp parallel num_threads(_pardegree+1)
+#pragma omp single
+		{
+			Problem p;
+			while(_input.pop(p))
+			{
+				acquireSlot();
+				long id=next_id++;
+#pragma omp task firstprivate(p,id)
+				{
+					DacOpenmp<OperandType,ResultType> dac(_divide_fn,_combine_fn,_seq_fn,_condition_fn,*p.first,*p.second,_pardegree);
+					dac.computeNested();
+					deliver(p,id);
+				}
+			}
+#pragma omp taskwait
+		}
+		_output.close();
+	}
+
+
+private:
+
+	//wait until the number of problems in flight allows to start another one
+	void acquireSlot()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_slot_freed.wait(lock,[this]{return _inflight<_max_inflight;});
+		_inflight++;
+	}
+
+	void deliver(const Problem &p, long id)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if(_ordered)
+		{
+			//problems completed out of order keep their slot until they are delivered
+			_reorder[id]=p;
+			while(!_reorder.empty() && _reorder.begin()->first==_next_out)
+			{
+				_output.push(_reorder.begin()->second);
+				_reorder.erase(_reorder.begin());
+				_next_out++;
+				_inflight--;
+			}
+		}
+		else
+		{
+			_output.push(p);
+			_inflight--;
+		}
+		_slot_freed.notify_one();
+	}
+
+	//function pointers
+	const std::function<void(const OperandType&,std::vector<OperandType>&)>& _divide_fn;
+	const std::function<void(std::vector<ResultType>&,ResultType&)>& _combine_fn;
+	const std::function<void(const OperandType& ,  ResultType&)>& _seq_fn;
+	const std::function<bool(const OperandType&)>& _condition_fn;
+	DacQueue<Problem>& _input;
+	DacQueue<Problem>& _output;
+
+	int _pardegree;
+	int _max_inflight;
+	bool _ordered;
+
+	std::mutex _mutex;
+	std::condition_variable _slot_freed;
+	int _inflight;
+	long _next_out;					//next problem to deliver (ordered)
+	std::map<long,Problem> _reorder;	//completed problems waiting for the previous ones (ordered)
+};
+
+#endif // DAC_FARM_HPP
@@ -0,0 +1,52 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Incremental recomputation.
+
+ In incremental mode a run retains the whole DAC tree: the operands produced by every divide and the
+ results of every node. After a partial change of the input the caller gives a dirty function, telling
+ whether the input of a node has changed; only the dirty nodes are solved again:
+ - a dirty leaf is solved again by the base case;
+ - a dirty node is divided again (its subproblems may be derived from the input, e.g. the sums of
+   Strassen) and combines the new results of its dirty children with the retained ones of the others.
+ A node can be dirty only if its parent is (the dirty function must be consistent along the paths):
+ the retained operands of the clean subtrees are never used again, so they may refer to data that
+ has been released.
+
+ The base case and the combine overwrite the results of the previous run: they must release what
+ a previous result owns. The problem must not change the input in place (e.g. in place sorts can not
+ be recomputed: their leaves no longer correspond to the ranges of the input).
+*/
+
+#ifndef DAC_INCREMENTAL_HPP
+#define DAC_INCREMENTAL_HPP
+
+#include <vector>
+#include <memory>
+
+/*
+ * Retained non-leaf node: leaves are represented by their operand and result in the parent
+ */
+template<typename OperandType,typename ResultType>
+struct DacRetainedNode{
+	std::vector<OperandType> ops;		//operands of the children, as produced by the last divide
+	std::vector<ResultType> ress;
+	std::vector<std::unique_ptr<DacRetainedNode>> children;		//null for the leaves
+};
+
+#endif // DAC_INCREMENTAL_HPP
@@ -0,0 +1,177 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Sequential execution of a DAC subtree with batched leaves.
+
+ The subtree is visited depth first (with an explicit stack, as in DacExplicitStack) but the leaves
+ are not solved as soon as they are found: they are collected and solved batch_size at a time by
+ a single call of the batched base case, that can process them with SIMD instructions and amortizes
+ the cost of the call. A node whose leaves are still pending is kept aside and combined as soon as
+ the batch containing its last leaf has been solved.
+*/
+
+#ifndef DAC_LEAF_BATCHER_HPP
+#define DAC_LEAF_BATCHER_HPP
+
+#include <vector>
+#include <functional>
+
+template<typename OperandType,typename ResultType>
+class DacLeafBatcher{
+
+public:
+
+	DacLeafBatcher(const std::function<void(const OperandType&,std::vector<OperandType>&)>& divide_fn,
+				   const std::function<void(std::vector<ResultType>&,ResultType&)>& combine_fn,
+				   const std::function<void(const std::vector<const OperandType*>&,const std::vector<ResultType*>&)>& seq_batch_fn,
+				   const std::function<bool(const OperandType&)>& cond_fn, int batch_size):
+						_divide_fn(divide_fn), _combine_fn(combine_fn), _seq_batch_fn(seq_batch_fn), _condition_fn(cond_fn),
+						_batch_size(batch_size>0?batch_size:1)
+	{}
+
+	~DacLeafBatcher()
+	{
+		for(Frame *f:_free)
+			delete f;
+	}
+
+	/**
+	 * @brief compute solves the subtree rooted in op
+	 */
+	void compute(const OperandType *op, ResultType *res)
+	{
+		if(_condition_fn(*op))
+		{
+			addLeaf(op,res,nullptr);
+			flush();
+			return;
+		}
+
+		push(op,res,nullptr);
+		while(!_stack.empty())
+		{
+			Frame *f=_stack.back();
+			if(f->next<f->ops.size())
+			{
+				//go on with the next child
+				size_t i=f->next++;
+				f->pending++;
+				if(_condition_fn(f->ops[i]))
+					addLeaf(&f->ops[i],&f->ress[i],f);
+				else
+					push(&f->ops[i],&f->ress[i],f);
+			}
+			else
+			{
+				//all the children have been found: the node is combined now or once its last leaf is solved
+				_stack.pop_back();
+				f->on_stack=false;
+				if(f->pending==0)
+					complete(f);
+			}
+		}
+		flush();
+	}
+
+private:
+
+	struct Frame{
+		ResultType *res;
+		Frame *parent;
+		std::vector<OperandType> ops;
+		std::vector<ResultType> ress;
+		size_t next;		//next child to visit
+		int pending;		//visited children not yet solved
+		bool on_stack;
+	};
+
+	void push(const OperandType *op, ResultType *res, Frame *parent)
+	{
+		Frame *f;
+		if(_free.empty())
+			f=new Frame();
+		else
+		{
+			f=_free.back();
+			_free.pop_back();
+		}
+		f->res=res;
+		f->parent=parent;
+		f->next=0;
+		f->pending=0;
+		f->on_stack=true;
+		_divide_fn(*op,f->ops);
+		f->ress.resize(f->ops.size());
+		_stack.push_back(f);
+	}
+
+	void addLeaf(const OperandType *op, ResultType *res, Frame *parent)
+	{
+		_leaf_ops.push_back(op);
+		_leaf_ress.push_back(res);
+		_leaf_parents.push_back(parent);
+		if((int)_leaf_ops.size()>=_batch_size)
+			flush();
+	}
+
+	//solve the pending leaves and complete the nodes that were waiting for them
+	void flush()
+	{
+		if(_leaf_ops.empty())
+			return;
+		_seq_batch_fn(_leaf_ops,_leaf_ress);
+		for(Frame *f:_leaf_parents)
+		{
+			if(f!=nullptr && --f->pending==0 && !f->on_stack)
+				complete(f);
+		}
+		_leaf_ops.clear();
+		_leaf_ress.clear();
+		_leaf_parents.clear();
+	}
+
+	//combine a node and, going up, all the ancestors that were waiting only for it
+	void complete(Frame *f)
+	{
+		while(f!=nullptr)
+		{
+			_combine_fn(f->ress,*f->res);
+			Frame *parent=f->parent;
+			f->ops.clear();
+			f->ress.clear();
+			_free.push_back(f);
+			if(parent==nullptr || --parent->pending>0 || parent->on_stack)
+				break;
+			f=parent;
+		}
+	}
+
+	const std::function<void(const OperandType&,std::vector<OperandType>&)>& _divide_fn;
+	const std::function<void(std::vector<ResultType>&,ResultType&)>& _combine_fn;
+	const std::function<void(const std::vector<const OperandType*>&,const std::vector<ResultType*>&)>& _seq_batch_fn;
+	const std::function<bool(const OperandType&)>& _condition_fn;
+	int _batch_size;
+
+	std::vector<Frame*> _stack;
+	std::vector<Frame*> _free;
+	std::vector<const OperandType*> _leaf_ops;
+	std::vector<ResultType*> _leaf_ress;
+	std::vector<Frame*> _leaf_parents;
+};
+
+#endif // DAC_LEAF_BATCHER_HPP
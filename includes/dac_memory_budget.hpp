@@ -0,0 +1,67 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Accounting of the memory used by the temporaries of the nodes that are being
+ solved in parallel. Before dividing a node the backends reserve its estimated
+ memory: if this would exceed the budget, the subtree is solved depth first
+ (by the worker that reached it) instead of spawning more tasks.
+*/
+
+#ifndef DAC_MEMORY_BUDGET_HPP
+#define DAC_MEMORY_BUDGET_HPP
+
+#include <atomic>
+#include <cstddef>
+
+class DacMemoryBudget{
+
+public:
+
+	DacMemoryBudget(): _budget(0), _used(0)
+	{}
+
+	void setBudget(size_t bytes)
+	{
+		_budget=bytes;
+	}
+
+	/**
+	 * @brief reserve accounts bytes to the memory in use
+	 * @return false (and nothing is reserved) if the budget would be exceeded
+	 */
+	bool reserve(size_t bytes)
+	{
+		size_t used=_used.load(std::memory_order_relaxed);
+		do{
+			if(used+bytes>_budget)
+				return false;
+		}while(!_used.compare_exchange_weak(used,used+bytes,std::memory_order_relaxed));
+		return true;
+	}
+
+	void release(size_t bytes)
+	{
+		_used.fetch_sub(bytes,std::memory_order_relaxed);
+	}
+
+private:
+	size_t _budget;
+	std::atomic<size_t> _used;
+};
+
+#endif // DAC_MEMORY_BUDGET_HPP
@@ -26,7 +26,22 @@
 #define DAC_OPENMP_HPP
 #include <vector>
 #include <functional>
+#include <memory>
+#include <atomic>
 #include <omp.h>
+#include "dac_explicit_stack.hpp"
+#include "dac_sequential.hpp"
+#include "dac_memory_budget.hpp"
+#include "dac_leaf_batcher.hpp"
+#include "dac_reduction.hpp"
+#include "dac_spawn_policy.hpp"
+#include "dac_work_span.hpp"
+#include "dac_partial_combine.hpp"
+#include "dac_elastic.hpp"
+#include "dac_dag.hpp"
+#include "dac_incremental.hpp"
+#include "dac_probes.hpp"
+#include "dac_schedule.hpp"
 
 // This is a first implementation prone to optimizations (especially considering cutoff that for the moment being is statically found)
 
@@ -39,24 +54,460 @@ public:
 			  const std::function<void(std::vector<ResultType>&,ResultType&)>& combine_fn,
 			  const std::function<void(const OperandType&, ResultType&)>& seq_fn,
 			  const std::function<bool(const OperandType&)>& cond_fn, const OperandType& op, ResultType& res, int pardegree):
-				_divide_fn(divide_fn), _combine_fn(combine_fn), _seq_fn(seq_fn), _condition_fn(cond_fn), _op(&op), _res(&res), _pardegree(pardegree)
+				_divide_fn(divide_fn), _combine_fn(combine_fn), _seq_fn(seq_fn), _condition_fn(cond_fn), _op(&op), _res(&res), _pardegree(pardegree), _max_depth(DAC_MAX_RECURSION_DEPTH), _batch_size(0), _batch_depth(0), _accumulators(nullptr), _spawn_policy(DAC_HELP_FIRST), _hybrid_depth(0), _work_span_analysis(false), _lazy_splitting(false), _queued(0), _incremental(false), _schedule(nullptr)
 	{}
 
+	/**
+	 * @brief setMaxRecursionDepth nodes deeper than depth are solved by the worker that reaches them
+	 * using an explicit stack, so native stack usage is bounded whatever is the shape of the tree. <=0: no limit
+	 */
+	void setMaxRecursionDepth(int depth)
+	{
+		_max_depth=depth;
+	}
+
+	/**
+	 * @brief setMemoryBudget limits the memory used by the temporaries of the nodes being solved in parallel.
+	 * mem_fn estimates the temporaries (subproblems and partial results) of a non-leaf node: when they would
+	 * exceed budget bytes the node is solved depth first, without spawning tasks
+	 */
+	void setMemoryBudget(size_t budget, const std::function<size_t(const OperandType&)>& mem_fn)
+	{
+		_mem_budget.setBudget(budget);
+		_mem_fn=mem_fn;
+	}
+
+	/**
+	 * @brief setBatchedLeaves subtrees rooted at depth>=batch_depth are solved by a single worker that collects
+	 * their leaves and solves them batch_size at a time with seq_batch_fn, instead of calling seq_fn on each of them
+	 */
+	void setBatchedLeaves(const std::function<void(const std::vector<const OperandType*>&,const std::vector<ResultType*>&)>& seq_batch_fn,
+						  int batch_size, int batch_depth)
+	{
+		_seq_batch_fn=seq_batch_fn;
+		_batch_size=batch_size;
+		_batch_depth=batch_depth;
+	}
+
+	/**
+	 * @brief setReduction the combine is an associative and commutative reduction: the results of the leaves
+	 * (and of the subtrees solved depth first) are folded by reduce_fn(partial,acc) into per-worker accumulators
+	 * starting from identity, and parents do not wait for their children. The memory budget is not used in this mode
+	 */
+	void setReduction(const std::function<void(const ResultType&,ResultType&)>& reduce_fn, const ResultType &identity)
+	{
+		_reduce_fn=reduce_fn;
+		_identity.reset(new ResultType(identity));
+	}
+
+	/**
+	 * @brief setSpawnPolicy how the children of a node are spawned (see dac_spawn_policy.hpp). Default: help first.
+	 * With DAC_HYBRID nodes at depth<hybrid_depth are help first, the others work first
+	 */
+	void setSpawnPolicy(DacSpawnPolicy policy, int hybrid_depth=0)
+	{
+		_spawn_policy=policy;
+		_hybrid_depth=hybrid_depth;
+	}
+
+	/**
+	 * @brief setPartialCombine the combine of the nodes solved in parallel is decomposed into steps, each one
+	 * fired as soon as the children it uses have completed (see dac_partial_combine.hpp)
+	 */
+	void setPartialCombine(const std::function<void(const OperandType&,ResultType&)>& init_fn,
+						   const std::vector<DacCombineStep<ResultType>>& steps,
+						   const std::function<void(ResultType&)>& release_fn=nullptr)
+	{
+		_partial_combine=DacPartialCombine<OperandType,ResultType>(init_fn,steps,release_fn);
+	}
+
+	/**
+	 * @brief setWorkSpanAnalysis times every node of the following runs to compute their work and span
+	 * (see dac_work_span.hpp). The analysis uses the standard execution: the reduction mode and the sequential
+	 * execution with one worker are disabled while it is active
+	 */
+	void setWorkSpanAnalysis(bool enable)
+	{
+		_work_span_analysis=enable;
+	}
+
+	/**
+	 * @brief getWorkSpan work and span measured by the last run with the analysis enabled
+	 */
+	const DacWorkSpan& getWorkSpan() const
+	{
+		return _work_span;
+	}
+
+	/**
+	 * @brief setElastic the number of active workers follows the load of the host, between min_workers
+	 * and max_workers (see dac_elastic.hpp). max_workers replaces the parallelism degree
+	 */
+	void setElastic(int min_workers, int max_workers)
+	{
+		_pardegree=max_workers;
+		_elastic.reset(new DacElasticMonitor(min_workers,max_workers));
+	}
+
+	/**
+	 * @brief setLazySplitting children are spawned only when there is demand for them, i.e. when the tasks
+	 * spawned and not yet started by any worker are less than the workers. Otherwise they are solved by
+	 * the worker that divided their parent: the number of tasks follows the idle workers, not the input size
+	 */
+	void setLazySplitting(bool enable)
+	{
+		_lazy_splitting=enable;
+	}
+
+	/**
+	 * @brief setDependencies the children of a node depend on their siblings (see dac_dag.hpp): dep_fn(op,children,preds)
+	 * fills preds[i] with the indexes of the children that must be completed before the i-th one starts.
+	 * Children are always spawned as soon as they are ready (the spawn policy, lazy splitting and elastic mode
+	 * are not used for them). Not available in reduction mode
+	 */
+	void setDependencies(const std::function<void(const OperandType&,const std::vector<OperandType>&,std::vector<std::vector<int>>&)>& dep_fn)
+	{
+		_dependencies_fn=dep_fn;
+	}
+
+	/**
+	 * @brief setIncremental compute() retains the tree and the results of all the nodes, so that after
+	 * a partial change of the input the result can be updated by recompute() (see dac_incremental.hpp).
+	 * The other options (reduction, partial combine, dependencies, ...) are not used in this mode
+	 */
+	void setIncremental(bool enable)
+	{
+		_incremental=enable;
+		if(!enable)
+			_retained.reset();
+	}
+
+	/**
+	 * @brief recompute updates the result of the last compute() (in incremental mode) after a change of the input:
+	 * dirty_fn(op) tells whether the input of a node has changed. Only the dirty nodes are solved again
+	 */
+	void recompute(const std::function<bool(const OperandType&)>& dirty_fn)
+	{
+		if(!dirty_fn(*_op))
+			return;
+#pragma omp parallel num_threads(_pardegree)
+#pragma omp single
+		incrementalDac(_op,_res,_retained,&dirty_fn);
+	}
+
+	/**
+	 * @brief setProbeSize size_fn(op) gives the size of an operand reported by the static probes (see dac_probes.hpp).
+	 * It is called only if the program is compiled with DAC_USDT, while a tracer is attached to the probe
+	 */
+	void setProbeSize(const std::function<long(const OperandType&)>& size_fn)
+	{
+		_probe_size_fn=size_fn;
+	}
+
+	/**
+	 * @brief setSchedule the runs record a static partition of the subtrees among the workers, and replay it
+	 * when the tree has the recorded shape (see dac_schedule.hpp). The schedule must outlive the runs; null
+	 * disables it. Only the batched leaves are used in this mode, among the other options
+	 */
+	void setSchedule(DacSchedule *schedule)
+	{
+		_schedule=schedule;
+	}
+
 	void compute()
 	{
-		//call recursive DAC
+		DAC_PROBE1(compute_start,_pardegree);
+		if(_incremental)
+		{
+			_retained.reset();
+#pragma omp parallel num_threads(_pardegree)
+#pragma omp single
+			incrementalDac(_op,_res,_retained,nullptr);
+			DAC_PROBE0(compute_end);
+			return;
+		}
+
+		if(_schedule && _pardegree>1)
+		{
+			computeScheduled();
+			DAC_PROBE0(compute_end);
+			return;
+		}
+
+		if(_elastic)
+			_elastic->start();
+
+		if(_work_span_analysis)
+		{
 #pragma omp parallel num_threads(_pardegree)
 #pragma omp single
-		recursiveDac(_op,_res);
+			recursiveDac(_op,_res,0,&_work_span);
+		}
+		else if(_pardegree==1)
+		{
+			//a single worker: plain sequential recursion, without the parallel runtime
+			computeSequential();
+		}
+		else if(_reduce_fn)
+			computeReduction();
+		else
+		{
+			//call recursive DAC
+#pragma omp parallel num_threads(_pardegree)
+#pragma omp single
+			recursiveDac(_op,_res,0);
+		}
+
+		if(_elastic)
+			_elastic->stop();
+		DAC_PROBE0(compute_end);
+	}
+
+	/**
+	 * @brief computeNested runs the computation from a task of an already active parallel region
+	 * (e.g. the one of a DacFarm), using its threads
+	 */
+	void computeNested()
+	{
+		recursiveDac(_op,_res,0);
 	}
 
 
 private:
 
-	void recursiveDac(const OperandType *op, ResultType *ret)
+	void computeSequential()
+	{
+		if(_seq_batch_fn)
+			solveDepthFirst(_op,_res);
+		else
+		{
+			DacSequential<OperandType,ResultType> dac(_divide_fn,_combine_fn,_seq_fn,_condition_fn,*_op,*_res);
+			dac.setMaxRecursionDepth(_max_depth);
+			dac.compute();
+		}
+	}
+
+	typedef typename DacPartialCombine<OperandType,ResultType>::Node PartialCombineNode;
+	typedef DacRetainedNode<OperandType,ResultType> RetainedNode;
+
+	//the tree above the split depth is kept in a retained tree (null for the roots of the subtrees)
+	void computeScheduled()
+	{
+		std::unique_ptr<RetainedNode> root;
+		std::vector<int> shape;
+		std::vector<const OperandType*> sub_ops;
+		std::vector<ResultType*> sub_ress;
+		std::vector<double> times;
+		bool replay=false;
+		const std::vector<std::vector<int>> *lists=nullptr;
+		std::unique_ptr<std::atomic<bool>[]> started;
+
+#pragma omp parallel num_threads(_pardegree)
+		{
+#pragma omp single
+			scheduleDivide(_op,root,0);
+			//all the divide tasks have completed at the end of the single
+
+#pragma omp single
+			{
+				if(root)
+					collectSubtrees(*root,shape,sub_ops,sub_ress);
+				else
+				{
+					shape.push_back(0);
+					sub_ops.push_back(_op);
+					sub_ress.push_back(_res);
+				}
+				times.resize(sub_ops.size());
+				started.reset(new std::atomic<bool>[sub_ops.size()]);
+				for(size_t i=0;i<sub_ops.size();i++)
+					started[i].store(false,std::memory_order_relaxed);
+				replay=_schedule->matches(shape);
+				if(replay)
+					lists=&_schedule->assignment(_pardegree);
+				else
+				{
+					//record: the subtrees are dynamically scheduled tasks
+					for(size_t i=0;i<sub_ops.size();i++)
+					{
+#pragma omp task firstprivate(i)
+						solveSubtree(sub_ops[i],sub_ress[i],&times[i]);
+					}
+				}
+			}
+
+			if(replay)
+			{
+				//own subtrees first, then the ones not yet started by the others (last first)
+				int me=omp_get_thread_num();
+				for(int s:(*lists)[me])
+				{
+					if(!started[s].exchange(true,std::memory_order_relaxed))
+						solveSubtree(sub_ops[s],sub_ress[s],nullptr);
+				}
+				for(int w=1;w<_pardegree;w++)
+				{
+					const std::vector<int> &other=(*lists)[(me+w)%_pardegree];
+					for(auto it=other.rbegin();it!=other.rend();++it)
+					{
+						if(!started[*it].exchange(true,std::memory_order_relaxed))
+							solveSubtree(sub_ops[*it],sub_ress[*it],nullptr);
+					}
+				}
+			}
+#pragma omp barrier
+
+#pragma omp single
+			{
+				if(!replay)
+					_schedule->record(shape,times);
+				if(root)
+					scheduleCombine(*_op,*root,_res,0);
+			}
+		}
+	}
+
+	void scheduleDivide(const OperandType *op, std::unique_ptr<RetainedNode> &node, int depth)
+	{
+		if(depth>=_schedule->splitDepth() || _condition_fn(*op))
+			return;
+		node.reset(new RetainedNode());
+		_divide_fn(*op,node->ops);
+		int branch_factor=node->ops.size();
+		node->ress.resize(branch_factor);
+		node->children.resize(branch_factor);
+		for(int i=0;i<branch_factor;i++)
+		{
+			RetainedNode *n=node.get();
+#pragma omp task firstprivate(n,i)
+			scheduleDivide(&n->ops[i],n->children[i],depth+1);
+		}
+	}
+
+	//shape of the tree and roots of the subtrees, in preorder
+	void collectSubtrees(RetainedNode &node, std::vector<int> &shape, std::vector<const OperandType*> &sub_ops, std::vector<ResultType*> &sub_ress)
+	{
+		shape.push_back(node.ops.size());
+		for(size_t i=0;i<node.ops.size();i++)
+		{
+			if(node.children[i])
+				collectSubtrees(*node.children[i],shape,sub_ops,sub_ress);
+			else
+			{
+				shape.push_back(0);
+				sub_ops.push_back(&node.ops[i]);
+				sub_ress.push_back(&node.ress[i]);
+			}
+		}
+	}
+
+	//time: if not null, where the time of the subtree is stored (usecs)
+	void solveSubtree(const OperandType *op, ResultType *ret, double *time)
 	{
+		DacWorkSpanTimer timer(time!=nullptr);
+		DAC_PROBE2(subtree_start,_schedule->splitDepth(),probeSize(*op));
+		solveDepthFirst(op,ret);
+		DAC_PROBE2(subtree_end,_schedule->splitDepth(),probeSize(*op));
+		if(time)
+			*time=timer.lap();
+	}
+
+	void scheduleCombine(const OperandType &op, RetainedNode &node, ResultType *ret, int depth)
+	{
+		for(size_t i=0;i<node.ops.size();i++)
+		{
+			if(node.children[i])
+			{
+				RetainedNode *n=node.children[i].get();
+				const OperandType *child_op=&node.ops[i];
+				ResultType *child_ret=&node.ress[i];
+#pragma omp task firstprivate(n,child_op,child_ret)
+				scheduleCombine(*child_op,*n,child_ret,depth+1);
+			}
+		}
+#pragma omp taskwait
+		DAC_PROBE2(combine_start,depth,probeSize(op));
+		_combine_fn(node.ress,*ret);
+		DAC_PROBE2(combine_end,depth,probeSize(op));
+	}
+
+	void computeReduction()
+	{
+		DacAccumulators<ResultType> accumulators(_pardegree,*_identity,_reduce_fn);
+		_accumulators=&accumulators;
+#pragma omp parallel num_threads(_pardegree)
+#pragma omp single
+		reduceDac(_op,0);
+
+		//all the tasks have completed at the end of the parallel region
+		*_res=*_identity;
+		accumulators.result(*_res);
+		_accumulators=nullptr;
+	}
+
+	void reduceDac(const OperandType *op, int depth)
+	{
+		if((_seq_batch_fn && depth>=_batch_depth) || (_max_depth>0 && depth>=_max_depth))
+		{
+			//batched leaves or too deep: solve the subtree depth first and reduce its result
+			ResultType res;
+			DAC_PROBE2(subtree_start,depth,probeSize(*op));
+			solveDepthFirst(op,&res);
+			DAC_PROBE2(subtree_end,depth,probeSize(*op));
+			_accumulators->accumulate(omp_get_thread_num(),res);
+		}
+		else if(!_condition_fn(*op)) //not the base case
+		{
+			std::vector<OperandType> ops;
+			_divide_fn(*op,ops);
+
+			//each child task owns its operand, so that this node can end without waiting for it
+			int spawned=dacInlineLastChild(_spawn_policy,_hybrid_depth,depth) ? ops.size()-1 : ops.size();
+			for(int i=0;i<(int)ops.size();i++)
+			{
+				if(i<spawned && spawnChild())
+				{
+					OperandType *child=new OperandType(std::move(ops[i]));
+					DAC_PROBE2(spawn,depth+1,probeSize(*child));
+					int spawner=probeWorker();
+#pragma omp task firstprivate(child,spawner)
+					{
+						taskStarted();
+						probeTaskStarted(spawner,depth+1,*child);
+						reduceDac(child,depth+1);
+						delete child;
+						taskCompleted();
+					}
+				}
+				else
+					reduceDac(&ops[i],depth+1);
+			}
+		}
+		else
+		{
+			ResultType res;
+			DAC_PROBE2(leaf_start,depth,probeSize(*op));
+			_seq_fn(*op,res);
+			DAC_PROBE2(leaf_end,depth,probeSize(*op));
+			_accumulators->accumulate(omp_get_thread_num(),res);
+		}
+	}
 
-		if(!_condition_fn(*op)) //not the base case
+	//ws: if not null, where the work and span of the subtree are stored
+	void recursiveDac(const OperandType *op, ResultType *ret, int depth, DacWorkSpan *ws=nullptr)
+	{
+		size_t mem=0;
+		DacWorkSpanTimer timer(ws!=nullptr);
+		if((_seq_batch_fn && depth>=_batch_depth) || (_max_depth>0 && depth>=_max_depth) || !reserveMemory(op,mem))
+		{
+			//batched leaves, too deep or over the memory budget: go on depth first, without recursion
+			DAC_PROBE2(subtree_start,depth,probeSize(*op));
+			solveDepthFirst(op,ret);
+			DAC_PROBE2(subtree_end,depth,probeSize(*op));
+			if(ws)
+				*ws=DacWorkSpan::leaf(timer.lap());
+		}
+		else if(!_condition_fn(*op)) //not the base case
 		{
 			//divide
 			std::vector<OperandType> *ops=new std::vector<OperandType>();
@@ -65,32 +516,283 @@ private:
 
 			//create the space for the partial results
 			std::vector<ResultType> *ress=new std::vector<ResultType>(branch_factor);
+			std::vector<DacWorkSpan> *children_ws=(ws ? new std::vector<DacWorkSpan>(branch_factor) : nullptr);
+			PartialCombineNode *pc=(_partial_combine.enabled() ? new PartialCombineNode(_partial_combine,*op,*ress,*ret) : nullptr);
+			DacDag *dag=nullptr;
+			if(_dependencies_fn)
+			{
+				std::vector<std::vector<int>> preds(branch_factor);
+				_dependencies_fn(*op,*ops,preds);
+				dag=new DacDag(preds);
+			}
+			double divide_time=timer.lap();
 
-			//create recursive tasks
-			for(int i=0;i<branch_factor;i++)
+			if(dag)
 			{
-#pragma omp task
+				//the children are spawned by the ones they depend on: the taskgroup waits for all of them
+#pragma omp taskgroup
 				{
-					recursiveDac(&(*ops)[i],&(*ress)[i]);
+					for(int i:dag->roots())
+						spawnDagChild(ops,ress,i,depth,children_ws,pc,dag);
 				}
 			}
+			else if(branch_factor>DAC_TREE_SPAWN_THRESHOLD)
+			{
+				//wide node: the children are spawned (and joined) by a tree of tasks
+				spawnRange(ops,ress,0,branch_factor,depth,children_ws,pc,true);
+			}
+			else
+			{
+				//create recursive tasks (work first: the last child is executed by this thread)
+				int spawned=dacInlineLastChild(_spawn_policy,_hybrid_depth,depth) ? branch_factor-1 : branch_factor;
+				for(int i=0;i<branch_factor;i++)
+				{
+					if(i<spawned && spawnChild())
+						spawnChildTask(ops,ress,i,depth,children_ws,pc);
+					else
+						solveChild(ops,ress,i,depth,children_ws,pc);
+				}
+				waitStarted();
 #pragma omp taskwait
+				waitEnded();
+			}
+			timer.lap();		//the children have been measured by themselves
 
 
 
-			//combine results
-			_combine_fn(*ress,*ret);
+			//combine results (with a partial combine all the steps have already been executed)
+			if(pc)
+				delete pc;
+			else
+			{
+				DAC_PROBE2(combine_start,depth,probeSize(*op));
+				_combine_fn(*ress,*ret);
+				DAC_PROBE2(combine_end,depth,probeSize(*op));
+			}
+			if(ws)
+			{
+				*ws=(dag ? DacWorkSpan::node(divide_time,*children_ws,dag->preds(),timer.lap())
+						 : DacWorkSpan::node(divide_time,*children_ws,timer.lap()));
+				delete children_ws;
+			}
+			if(dag)
+				delete dag;
 
 			//cleanup memory
 
 			delete ops;
 			delete ress;
+			if(mem>0)
+				_mem_budget.release(mem);
 		}
 		else
 		{
+			DAC_PROBE2(leaf_start,depth,probeSize(*op));
+			_seq_fn(*op,*ret);
+			DAC_PROBE2(leaf_end,depth,probeSize(*op));
+			if(ws)
+				*ws=DacWorkSpan::leaf(timer.lap());
+		}
+
+	}
+
+	//incremental mode: solves the node and retains its subtree in node. With a dirty function the node has
+	//already been solved (and node retained): it is divided again and only its dirty children are solved
+	void incrementalDac(const OperandType *op, ResultType *ret, std::unique_ptr<RetainedNode> &node,
+						const std::function<bool(const OperandType&)> *dirty_fn, int depth=0)
+	{
+		if(!dirty_fn ? _condition_fn(*op) : !node)
+		{
+			DAC_PROBE2(leaf_start,depth,probeSize(*op));
 			_seq_fn(*op,*ret);
+			DAC_PROBE2(leaf_end,depth,probeSize(*op));
+			return;
+		}
+		std::vector<OperandType> ops;
+		_divide_fn(*op,ops);
+		int branch_factor=ops.size();
+		if(!dirty_fn)
+		{
+			node.reset(new RetainedNode());
+			node->ress.resize(branch_factor);
+			node->children.resize(branch_factor);
 		}
+		//the operands of the clean children are replaced as well: they are equal to the previous ones
+		node->ops.swap(ops);
 
+		for(int i=0;i<branch_factor;i++)
+		{
+			if(dirty_fn && !(*dirty_fn)(node->ops[i]))
+				continue;
+			RetainedNode *n=node.get();
+			DAC_PROBE2(spawn,depth+1,probeSize(n->ops[i]));
+			int spawner=probeWorker();
+#pragma omp task firstprivate(n,i,spawner)
+			{
+				probeTaskStarted(spawner,depth+1,n->ops[i]);
+				incrementalDac(&n->ops[i],&n->ress[i],n->children[i],dirty_fn,depth+1);
+			}
+		}
+#pragma omp taskwait
+		DAC_PROBE2(combine_start,depth,probeSize(*op));
+		_combine_fn(node->ress,*ret);
+		DAC_PROBE2(combine_end,depth,probeSize(*op));
+	}
+
+	//lazy splitting and elastic mode: a child is spawned only if some worker is waiting for work (and there
+	//is room for another task), otherwise it is solved by the calling worker
+	bool spawnChild()
+	{
+		if(_lazy_splitting && _queued.load(std::memory_order_relaxed)>=_pardegree)
+			return false;
+		if(_elastic && !_elastic->acquireTask())
+			return false;
+		if(_lazy_splitting)
+			_queued.fetch_add(1,std::memory_order_relaxed);
+		return true;
+	}
+
+	void taskStarted()
+	{
+		if(_lazy_splitting)
+			_queued.fetch_sub(1,std::memory_order_relaxed);
+	}
+
+	void taskCompleted()
+	{
+		if(_elastic)
+			_elastic->releaseTask();
+	}
+
+	//elastic mode: a task waiting for its children does not count among the running ones
+	void waitStarted()
+	{
+		if(_elastic)
+			_elastic->waitStarted();
+	}
+
+	void waitEnded()
+	{
+		if(_elastic)
+			_elastic->waitEnded();
+	}
+
+	//solve the i-th child of a node and notify its completion to the partial combine
+	void solveChild(std::vector<OperandType> *ops, std::vector<ResultType> *ress, int i, int depth,
+					std::vector<DacWorkSpan> *children_ws, PartialCombineNode *pc)
+	{
+		recursiveDac(&(*ops)[i],&(*ress)[i],depth+1,children_ws ? &(*children_ws)[i] : nullptr);
+		if(pc)
+			pc->childDone(i);
+	}
+
+	void spawnChildTask(std::vector<OperandType> *ops, std::vector<ResultType> *ress, int i, int depth,
+						std::vector<DacWorkSpan> *children_ws, PartialCombineNode *pc)
+	{
+		DAC_PROBE2(spawn,depth+1,probeSize((*ops)[i]));
+		int spawner=probeWorker();
+#pragma omp task firstprivate(i,spawner)
+		{
+			taskStarted();
+			probeTaskStarted(spawner,depth+1,(*ops)[i]);
+			solveChild(ops,ress,i,depth,children_ws,pc);
+			taskCompleted();
+		}
+	}
+
+	//spawn the children in [first,last) of a wide node: the lower half of the range is given to a new task
+	//until at most DAC_TREE_SPAWN_GRAIN children are left. Returns when all of them have been solved.
+	//node: called by the node (a running task in elastic mode), not by one of the tasks of the range
+	void spawnRange(std::vector<OperandType> *ops, std::vector<ResultType> *ress, int first, int last, int depth,
+					std::vector<DacWorkSpan> *children_ws, PartialCombineNode *pc, bool node)
+	{
+		while(last-first>DAC_TREE_SPAWN_GRAIN)
+		{
+			int mid=first+(last-first)/2;
+#pragma omp task firstprivate(first,mid)
+			spawnRange(ops,ress,first,mid,depth,children_ws,pc,false);
+			first=mid;
+		}
+		for(int i=first;i<last;i++)
+		{
+			if(spawnChild())
+				spawnChildTask(ops,ress,i,depth,children_ws,pc);
+			else
+				solveChild(ops,ress,i,depth,children_ws,pc);
+		}
+		if(node)
+			waitStarted();
+#pragma omp taskwait
+		if(node)
+			waitEnded();
+	}
+
+	//spawn a child with dependencies: once solved, it spawns the siblings that were waiting only for it
+	void spawnDagChild(std::vector<OperandType> *ops, std::vector<ResultType> *ress, int i, int depth,
+					   std::vector<DacWorkSpan> *children_ws, PartialCombineNode *pc, DacDag *dag)
+	{
+		DAC_PROBE2(spawn,depth+1,probeSize((*ops)[i]));
+		int spawner=probeWorker();
+#pragma omp task firstprivate(spawner)
+		{
+			probeTaskStarted(spawner,depth+1,(*ops)[i]);
+			solveChild(ops,ress,i,depth,children_ws,pc);
+			std::vector<int> ready;
+			dag->completed(i,ready);
+			for(int s:ready)
+				spawnDagChild(ops,ress,s,depth,children_ws,pc,dag);
+		}
+	}
+
+	long probeSize(const OperandType &op) const
+	{
+		return _probe_size_fn ? _probe_size_fn(op) : 0;
+	}
+
+	//worker spawning a task, to detect steals (only with the probes)
+	int probeWorker() const
+	{
+#if DAC_USDT
+		return omp_get_thread_num();
+#else
+		return 0;
+#endif
+	}
+
+	void probeTaskStarted(int spawner, int depth, const OperandType &op)
+	{
+#if DAC_USDT
+		if(spawner!=omp_get_thread_num())
+			DAC_PROBE2(steal,depth,probeSize(op));
+#else
+		(void)spawner;
+		(void)depth;
+		(void)op;
+#endif
+	}
+
+	//reserve the memory of the temporaries of a non-leaf node: false if this would exceed the budget
+	bool reserveMemory(const OperandType *op, size_t &mem)
+	{
+		if(!_mem_fn || _condition_fn(*op))
+			return true;
+		mem=_mem_fn(*op);
+		return _mem_budget.reserve(mem);
+	}
+
+	//solve a subtree on the calling worker, without recursion
+	void solveDepthFirst(const OperandType *op, ResultType *ret)
+	{
+		if(_seq_batch_fn)
+		{
+			DacLeafBatcher<OperandType,ResultType> batcher(_divide_fn,_combine_fn,_seq_batch_fn,_condition_fn,_batch_size);
+			batcher.compute(op,ret);
+		}
+		else
+		{
+			DacExplicitStack<OperandType,ResultType> stack(_divide_fn,_combine_fn,_seq_fn,_condition_fn);
+			stack.compute(op,ret);
+		}
 	}
 
 	//function pointers
@@ -102,6 +804,28 @@ private:
 	ResultType* _res;
 
 	int _pardegree;
+	int _max_depth;
+	DacMemoryBudget _mem_budget;
+	std::function<size_t(const OperandType&)> _mem_fn;
+	std::function<void(const std::vector<const OperandType*>&,const std::vector<ResultType*>&)> _seq_batch_fn;
+	int _batch_size;
+	int _batch_depth;
+	std::function<void(const ResultType&,ResultType&)> _reduce_fn;
+	std::unique_ptr<ResultType> _identity;		//allocated only in reduction mode
+	DacAccumulators<ResultType> *_accumulators;
+	DacSpawnPolicy _spawn_policy;
+	int _hybrid_depth;
+	bool _work_span_analysis;
+	DacWorkSpan _work_span;
+	DacPartialCombine<OperandType,ResultType> _partial_combine;
+	std::unique_ptr<DacElasticMonitor> _elastic;
+	bool _lazy_splitting;
+	std::atomic<int> _queued;		//tasks spawned and not yet started
+	std::function<void(const OperandType&,const std::vector<OperandType>&,std::vector<std::vector<int>>&)> _dependencies_fn;
+	bool _incremental;
+	std::unique_ptr<RetainedNode> _retained;		//incremental mode: the tree of the last run
+	std::function<long(const OperandType&)> _probe_size_fn;
+	DacSchedule *_schedule;
 };
 
 #endif // DAC_OPENMP_HPP
@@ -0,0 +1,50 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Parallel loop used inside the divide or the combine of a node (parallel merge, parallel partition),
+ with the tasks of the backend the program is compiled for: OpenMP or TBB. With the other backends
+ the iterations are run one after the other.
+*/
+
+#ifndef DAC_PARALLEL_FOR_HPP
+#define DAC_PARALLEL_FOR_HPP
+
+#include <functional>
+#if USE_TBB
+#include <tbb/parallel_for.h>
+#endif
+
+/**
+ * @brief dacParallelFor runs body(0),...,body(n-1) as parallel tasks, and waits for them. It must be called
+ * by a task of the backend (or outside any parallel computation)
+ */
+inline void dacParallelFor(int n, const std::function<void(int)>& body)
+{
+#if USE_TBB
+	tbb::parallel_for(0,n,body);
+#elif defined(_OPENMP)
+#pragma omp taskloop grainsize(1)
+	for(int i=0;i<n;i++)
+		body(i);
+#else
+	for(int i=0;i<n;i++)
+		body(i);
+#endif
+}
+
+#endif // DAC_PARALLEL_FOR_HPP
@@ -0,0 +1,83 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Parallel merge of two sorted runs, to be used by the combine of the upper levels of a merge sort
+ (where there are fewer nodes than workers, and a serial merge leaves most of them idle).
+
+ The output is cut into segments of the same length; for each cut the co-rank, i.e. how many of
+ the elements before it come from the first run, is found by a binary search along the merge path
+ (before any segment is merged, so the merge can move the elements).
+ The segments are then merged independently, by a given serial merge, as parallel tasks of the
+ backend the program is compiled for (OpenMP or TBB; with the others they are merged one after the
+ other). Ties are taken from the first run, so a stable serial merge gives a stable parallel merge.
+*/
+
+#ifndef DAC_PARALLEL_MERGE_HPP
+#define DAC_PARALLEL_MERGE_HPP
+
+#include <vector>
+#include <algorithm>
+#include "dac_parallel_for.hpp"
+
+/**
+ * @brief dacCoRank number of elements of the first run among the first k of the merge of x[0,n) and y[0,m)
+ */
+template<typename Iterator1, typename Iterator2, typename Compare>
+long dacCoRank(long k, Iterator1 x, long n, Iterator2 y, long m, Compare comp)
+{
+	long lo=std::max(0L,k-m);
+	long hi=std::min(k,n);
+	while(lo<hi)
+	{
+		long i=lo+(hi-lo)/2;
+		//x[i] is among the first k if it does not follow y[k-i-1]
+		if(!comp(*(y+(k-i-1)),*(x+i)))
+			lo=i+1;
+		else
+			hi=i;
+	}
+	return lo;
+}
+
+/**
+ * @brief dacParallelMerge merges [xs,xe) and [ys,ye) into zs using segments tasks: each one calls
+ * merge(xs',xe',ys',ye',zs') on its segment
+ */
+template<typename Iterator1, typename Iterator2, typename OutputIterator, typename Compare, typename Merge>
+void dacParallelMerge(Iterator1 xs, Iterator1 xe, Iterator2 ys, Iterator2 ye, OutputIterator zs, Compare comp, int segments, Merge merge)
+{
+	long n=xe-xs;
+	long m=ye-ys;
+	if(segments<=1)
+	{
+		merge(xs,xe,ys,ye,zs);
+		return;
+	}
+	//the cuts are found before merging: the merge may move the elements away from the runs
+	long length=(n+m+segments-1)/segments;
+	std::vector<long> cuts(segments+1);
+	for(int s=0;s<=segments;s++)
+		cuts[s]=dacCoRank(std::min(n+m,s*length),xs,n,ys,m,comp);
+	dacParallelFor(segments,[&](int s){
+		long first=std::min(n+m,s*length);
+		long last=std::min(n+m,first+length);
+		merge(xs+cuts[s],xs+cuts[s+1],ys+(first-cuts[s]),ys+(last-cuts[s+1]),zs+first);
+	});
+}
+
+#endif // DAC_PARALLEL_MERGE_HPP
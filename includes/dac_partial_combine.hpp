@@ -0,0 +1,139 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Dataflow combine: the combine of a node is decomposed into steps, each one depending on
+ a subset of the children, that are fired as soon as their inputs are available.
+
+ E.g. in Strassen C12=P3+P5 can be computed as soon as P3 and P5 are ready, while P6 is still
+ running. The combine overlaps with the slowest children and the result of a child can be
+ released as soon as all the steps that use it have been executed.
+
+ - init_fn(op,res) prepares the result of a node (e.g. allocates it), before its children start;
+ - each step reads the results of its inputs and writes its own part of the result: steps of the
+   same node may run at the same time, on the workers that completed their last input;
+ - release_fn (optional) frees the result of a child once it is no longer needed.
+ The steps must cover the whole combine: the combine function is still used by the subtrees
+ solved depth first.
+*/
+
+#ifndef DAC_PARTIAL_COMBINE_HPP
+#define DAC_PARTIAL_COMBINE_HPP
+
+#include <vector>
+#include <functional>
+#include <atomic>
+
+template<typename ResultType>
+struct DacCombineStep{
+	std::vector<int> inputs;		//indexes of the children used by the step
+	std::function<void(std::vector<ResultType>&,ResultType&)> fn;
+};
+
+template<typename OperandType,typename ResultType>
+class DacPartialCombine{
+
+public:
+
+	DacPartialCombine()
+	{}
+
+	DacPartialCombine(const std::function<void(const OperandType&,ResultType&)>& init_fn,
+					  const std::vector<DacCombineStep<ResultType>>& steps,
+					  const std::function<void(ResultType&)>& release_fn):
+						_init_fn(init_fn), _steps(steps), _release_fn(release_fn)
+	{
+		//for each child: the steps that wait for it
+		for(size_t s=0;s<_steps.size();s++)
+		{
+			for(int i:_steps[s].inputs)
+			{
+				if((int)_steps_of.size()<=i)
+					_steps_of.resize(i+1);
+				_steps_of[i].push_back(s);
+			}
+		}
+	}
+
+	bool enabled() const
+	{
+		return !_steps.empty();
+	}
+
+	/*
+	 * Combine of a node: it is initialized when the node has been divided, then
+	 * its children notify their completion
+	 */
+	class Node{
+
+	public:
+
+		Node(const DacPartialCombine &plan, const OperandType &op, std::vector<ResultType> &ress, ResultType &res):
+			_plan(plan), _ress(ress), _res(res), _missing(plan._steps.size()), _uses(plan._steps_of.size())
+		{
+			for(size_t s=0;s<_missing.size();s++)
+				_missing[s].store(plan._steps[s].inputs.size(),std::memory_order_relaxed);
+			for(size_t i=0;i<_uses.size();i++)
+				_uses[i].store(plan._steps_of[i].size(),std::memory_order_relaxed);
+			_plan._init_fn(op,res);
+		}
+
+		/**
+		 * @brief childDone called by the worker that completed the given child: it executes
+		 * the steps that were waiting only for it
+		 */
+		void childDone(int child)
+		{
+			if(child>=(int)_plan._steps_of.size())
+				return;
+			for(int s:_plan._steps_of[child])
+			{
+				if(_missing[s].fetch_sub(1,std::memory_order_acq_rel)==1)
+					runStep(s);
+			}
+		}
+
+	private:
+
+		void runStep(int s)
+		{
+			_plan._steps[s].fn(_ress,_res);
+			if(!_plan._release_fn)
+				return;
+			for(int i:_plan._steps[s].inputs)
+			{
+				if(_uses[i].fetch_sub(1,std::memory_order_acq_rel)==1)
+					_plan._release_fn(_ress[i]);
+			}
+		}
+
+		const DacPartialCombine &_plan;
+		std::vector<ResultType> &_ress;
+		ResultType &_res;
+		std::vector<std::atomic<int>> _missing;		//inputs not yet available, per step
+		std::vector<std::atomic<int>> _uses;		//steps not yet executed, per child
+	};
+
+private:
+
+	std::function<void(const OperandType&,ResultType&)> _init_fn;
+	std::vector<DacCombineStep<ResultType>> _steps;
+	std::function<void(ResultType&)> _release_fn;
+	std::vector<std::vector<int>> _steps_of;
+};
+
+#endif // DAC_PARTIAL_COMBINE_HPP
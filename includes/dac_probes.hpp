@@ -0,0 +1,71 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Static tracepoints (USDT) of the OpenMP and TBB backends.
+
+ If compiled with -DDAC_USDT (it requires sys/sdt.h, from the systemtap sdt development package)
+ the backends contain the following probes of the provider "dac":
+ - compute_start(pardegree), compute_end: a run of compute();
+ - spawn(depth,size): a child is spawned as a task;
+ - steal(depth,size): a task is started by a worker other than the one that spawned it;
+ - leaf_start(depth,size), leaf_end(depth,size): the base case of a node;
+ - subtree_start(depth,size), subtree_end(depth,size): a subtree solved depth first (batched leaves,
+   too deep or over the memory budget);
+ - combine_start(depth,size), combine_end(depth,size): the combine of a node.
+ The size of an operand is given by the function set with setProbeSize (0 if not set).
+ Each probe has a semaphore, that the tracer increments while it is attached: a probe that is not attached
+ costs the test of its semaphore, its arguments (e.g. the size of the operand) are not computed. Without
+ DAC_USDT the probes are not compiled at all.
+ E.g. the latency histogram of the leaves:
+
+	bpftrace -e 'usdt:./mergesort_dac_openmp:dac:leaf_start { @s[tid]=nsecs; }
+				 usdt:./mergesort_dac_openmp:dac:leaf_end /@s[tid]/ { @leaf=hist(nsecs-@s[tid]); delete(@s[tid]); }'
+*/
+
+#ifndef DAC_PROBES_HPP
+#define DAC_PROBES_HPP
+
+#if DAC_USDT
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+//weak: the header can be included by several translation units
+#define DAC_PROBE_SEMAPHORE(name)		__extension__ volatile unsigned short dac_##name##_semaphore \
+											__attribute__((weak,unused,section(".probes")))
+DAC_PROBE_SEMAPHORE(compute_start);
+DAC_PROBE_SEMAPHORE(compute_end);
+DAC_PROBE_SEMAPHORE(spawn);
+DAC_PROBE_SEMAPHORE(steal);
+DAC_PROBE_SEMAPHORE(leaf_start);
+DAC_PROBE_SEMAPHORE(leaf_end);
+DAC_PROBE_SEMAPHORE(subtree_start);
+DAC_PROBE_SEMAPHORE(subtree_end);
+DAC_PROBE_SEMAPHORE(combine_start);
+DAC_PROBE_SEMAPHORE(combine_end);
+
+#define DAC_PROBE_ENABLED(name)			__builtin_expect(dac_##name##_semaphore,0)
+#define DAC_PROBE0(name)				do{ if(DAC_PROBE_ENABLED(name)) DTRACE_PROBE(dac,name); }while(0)
+#define DAC_PROBE1(name,a)				do{ if(DAC_PROBE_ENABLED(name)) DTRACE_PROBE1(dac,name,a); }while(0)
+#define DAC_PROBE2(name,a,b)			do{ if(DAC_PROBE_ENABLED(name)) DTRACE_PROBE2(dac,name,a,b); }while(0)
+#else
+#define DAC_PROBE0(name)				do{}while(0)
+#define DAC_PROBE1(name,a)				do{}while(0)
+#define DAC_PROBE2(name,a,b)			do{}while(0)
+#endif
+
+#endif // DAC_PROBES_HPP
@@ -0,0 +1,232 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Per-host tuning profiles.
+
+ A profile stores, for each application, backend and problem size bucket (powers of two), the best
+ cutoff and parallelism degree found by the autotuner (dac_autotune). Applications load the profile
+ of the host at startup instead of relying only on their compiled-in cutoff.
+
+ The profile is a text file, one configuration per line:
+	<app> <backend> <log2(size)> <cutoff> <pardegree> <time_usecs>
+ By default it is $HOME/.dac_profile.<hostname>; the DAC_PROFILE environment variable overrides the path.
+*/
+
+#ifndef DAC_PROFILE_HPP
+#define DAC_PROFILE_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <unistd.h>
+#include <thread>
+
+//name of the backend the program has been compiled for
+#if USE_FF
+#define DAC_BACKEND_NAME "ff"
+#elif USE_OPENMP
+#define DAC_BACKEND_NAME "openmp"
+#elif USE_TBB
+#define DAC_BACKEND_NAME "tbb"
+#elif USE_CORO
+#define DAC_BACKEND_NAME "coro"
+#elif USE_SEQUENTIAL
+#define DAC_BACKEND_NAME "seq"
+#else
+#define DAC_BACKEND_NAME "none"
+#endif
+
+struct DacProfileEntry{
+	std::string app;
+	std::string backend;
+	int size_bucket;		//log2 of the problem size
+	int cutoff;
+	int pardegree;
+	long time_usecs;		//time measured by the autotuner
+};
+
+class DacProfile{
+
+public:
+
+	/**
+	 * @brief defaultPath path of the profile of this host
+	 */
+	static std::string defaultPath()
+	{
+		const char *env=getenv("DAC_PROFILE");
+		if(env!=nullptr)
+			return std::string(env);
+		char host[256];
+		if(gethostname(host,sizeof(host))!=0)
+			host[0]='\0';
+		host[sizeof(host)-1]='\0';
+		const char *home=getenv("HOME");
+		return std::string(home!=nullptr?home:".")+"/.dac_profile."+host;
+	}
+
+	/**
+	 * @brief host the profile of this host, loaded the first time it is requested
+	 */
+	static const DacProfile& host()
+	{
+		static DacProfile profile(defaultPath());
+		return profile;
+	}
+
+	static int sizeBucket(long size)
+	{
+		int bucket=0;
+		while(size>1)
+		{
+			size>>=1;
+			bucket++;
+		}
+		return bucket;
+	}
+
+	DacProfile()
+	{}
+
+	DacProfile(const std::string &path)
+	{
+		load(path);
+	}
+
+	/**
+	 * @brief load adds the configurations stored in a profile file
+	 * @return false if the file can not be read
+	 */
+	bool load(const std::string &path)
+	{
+		std::ifstream in(path.c_str());
+		if(!in)
+			return false;
+		std::string line;
+		while(std::getline(in,line))
+		{
+			if(line.empty() || line[0]=='#')
+				continue;
+			std::istringstream fields(line);
+			DacProfileEntry e;
+			if(fields >> e.app >> e.backend >> e.size_bucket >> e.cutoff >> e.pardegree >> e.time_usecs)
+				update(e);
+		}
+		return true;
+	}
+
+	bool save(const std::string &path) const
+	{
+		std::ofstream out(path.c_str());
+		if(!out)
+			return false;
+		out << "# app backend log2(size) cutoff pardegree time_usecs" << std::endl;
+		for(const DacProfileEntry &e:_entries)
+			out << e.app << " " << e.backend << " " << e.size_bucket << " " << e.cutoff << " " << e.pardegree << " " << e.time_usecs << std::endl;
+		return (bool)out;
+	}
+
+	/**
+	 * @brief update stores a configuration if it is the first one or the fastest one for its app, backend and size
+	 * bucket: to merge the measures of the same run
+	 */
+	void update(const DacProfileEntry &e)
+	{
+		DacProfileEntry *old=find(e);
+		if(old==nullptr)
+			_entries.push_back(e);
+		else if(e.time_usecs<old->time_usecs)
+			*old=e;
+	}
+
+	/**
+	 * @brief replace stores a configuration in place of the one for its app, backend and size bucket, whatever its
+	 * time: a new tuning (after a change of hardware, compiler or code) overrides the old one
+	 */
+	void replace(const DacProfileEntry &e)
+	{
+		DacProfileEntry *old=find(e);
+		if(old==nullptr)
+			_entries.push_back(e);
+		else
+			*old=e;
+	}
+
+	/**
+	 * @brief lookup finds the configuration for a problem of the given size (if its bucket has not been
+	 * tuned, the nearest one is used)
+	 * @return false if the app has not been tuned for this backend
+	 */
+	bool lookup(const std::string &app, const std::string &backend, long size, DacProfileEntry &found) const
+	{
+		int bucket=sizeBucket(size);
+		int best_distance=-1;
+		for(const DacProfileEntry &e:_entries)
+		{
+			if(e.app!=app || e.backend!=backend)
+				continue;
+			int distance=std::abs(e.size_bucket-bucket);
+			if(best_distance<0 || distance<best_distance)
+			{
+				best_distance=distance;
+				found=e;
+			}
+		}
+		return best_distance>=0;
+	}
+
+private:
+
+	DacProfileEntry *find(const DacProfileEntry &e)
+	{
+		for(DacProfileEntry &old:_entries)
+			if(old.app==e.app && old.backend==e.backend && old.size_bucket==e.size_bucket)
+				return &old;
+		return nullptr;
+	}
+
+	std::vector<DacProfileEntry> _entries;
+};
+
+
+/**
+ * @brief dacTunedCutoff cutoff to use for a problem of the given size: the DAC_CUTOFF environment variable
+ * if set (it is used by the autotuner), otherwise the one stored in the host profile, otherwise default_cutoff.
+ * A pardegree <=0 is replaced with the profiled one (or with the number of cores)
+ */
+inline int dacTunedCutoff(const char *app, long size, int default_cutoff, int &pardegree)
+{
+	int cutoff=default_cutoff;
+	DacProfileEntry e;
+	bool tuned=DacProfile::host().lookup(app,DAC_BACKEND_NAME,size,e);
+	if(tuned)
+		cutoff=e.cutoff;
+	const char *env=getenv("DAC_CUTOFF");
+	if(env!=nullptr && atoi(env)>0)
+		cutoff=atoi(env);
+	if(pardegree<=0)
+	{
+		int cores=std::thread::hardware_concurrency();
+		pardegree=(tuned && e.pardegree>0)?e.pardegree:(cores>0?cores:1);
+	}
+	return cutoff;
+}
+
+#endif // DAC_PROFILE_HPP
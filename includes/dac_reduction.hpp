@@ -0,0 +1,75 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Per-worker accumulators for the reduction mode of the backends.
+
+ When the combine is an associative and commutative reduction (e.g. a sum) the results of the
+ leaves do not need to travel up the tree: each worker folds them into its own accumulator and
+ the accumulators are reduced once at the end. Internal nodes have no partial results and parents
+ do not wait for their children.
+*/
+
+#ifndef DAC_REDUCTION_HPP
+#define DAC_REDUCTION_HPP
+
+#include <vector>
+#include <functional>
+
+template<typename ResultType>
+class DacAccumulators{
+
+public:
+
+	DacAccumulators(int nworkers, const ResultType &identity, const std::function<void(const ResultType&,ResultType&)>& reduce_fn):
+		_slots(nworkers>0?nworkers:1), _reduce_fn(reduce_fn)
+	{
+		for(Slot &s:_slots)
+			s.value=identity;
+	}
+
+	/**
+	 * @brief accumulate folds a partial result into the accumulator of a worker
+	 */
+	void accumulate(int worker, const ResultType &partial)
+	{
+		_reduce_fn(partial,_slots[worker].value);
+	}
+
+	/**
+	 * @brief result reduces the accumulators of all the workers into res, that must hold the identity
+	 */
+	void result(ResultType &res) const
+	{
+		for(const Slot &s:_slots)
+			_reduce_fn(s.value,res);
+	}
+
+private:
+
+	//accumulators are a cache line apart: workers do not invalidate each other lines
+	//(padding instead of alignas, that std::allocator does not honour before C++17)
+	struct Slot{
+		ResultType value;
+		char padding[64];
+	};
+
+	std::vector<Slot> _slots;
+	const std::function<void(const ResultType&,ResultType&)>& _reduce_fn;
+};
+
+#endif // DAC_REDUCTION_HPP
@@ -0,0 +1,117 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Recorded schedule, for problems of the same shape solved again and again (e.g. products of matrices
+ of the same size).
+
+ The tree is cut at the split depth: the nodes above it are divided and combined by tasks, the subtrees
+ below it are solved depth first, each one by a single worker. The first run records the shape of the
+ tree above the cut and the time of every subtree, solving the subtrees as dynamically scheduled tasks.
+ From the times the schedule assigns the subtrees to the workers (longest first, each one to the least
+ loaded worker): the following runs with the same shape replay this static partition, each worker
+ solving its own subtrees without spawning tasks. A worker that ends its list takes the subtrees not
+ yet started from the lists of the others, so a slower run does not wait for a single late worker.
+ The same subtrees go to the same worker in every run, which finds their data in its caches.
+
+ A run whose shape differs from the recorded one (or the first run after reset) records it again.
+ The object belongs to the caller and can be shared by the backends solving problems of the same shape.
+*/
+
+#ifndef DAC_SCHEDULE_HPP
+#define DAC_SCHEDULE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <map>
+
+class DacSchedule{
+
+public:
+
+	DacSchedule(int split_depth): _split_depth(split_depth>0?split_depth:1)
+	{}
+
+	int splitDepth() const
+	{
+		return _split_depth;
+	}
+
+	/**
+	 * @brief matches whether a tree with the given shape (see record) can replay the schedule
+	 */
+	bool matches(const std::vector<int> &shape) const
+	{
+		return !_times.empty() && shape==_shape;
+	}
+
+	/**
+	 * @brief record stores a new schedule. shape: the number of children of the nodes above the cut in
+	 * preorder, 0 for the roots of the subtrees; times: the time of the subtrees, in preorder
+	 */
+	void record(const std::vector<int> &shape, const std::vector<double> &times)
+	{
+		_shape=shape;
+		_times=times;
+		_assignments.clear();
+	}
+
+	/**
+	 * @brief reset the next run records the schedule again
+	 */
+	void reset()
+	{
+		_shape.clear();
+		_times.clear();
+		_assignments.clear();
+	}
+
+	/**
+	 * @brief assignment the indexes of the subtrees solved by each of the nworkers workers, in preorder
+	 */
+	const std::vector<std::vector<int>>& assignment(int nworkers)
+	{
+		std::vector<std::vector<int>> &lists=_assignments[nworkers];
+		if(lists.empty())
+		{
+			std::vector<int> order(_times.size());
+			for(size_t i=0;i<order.size();i++)
+				order[i]=i;
+			std::stable_sort(order.begin(),order.end(),[this](int x, int y){ return _times[x]>_times[y]; });
+			lists.resize(nworkers);
+			std::vector<double> load(nworkers,0);
+			for(int s:order)
+			{
+				int w=std::min_element(load.begin(),load.end())-load.begin();
+				lists[w].push_back(s);
+				load[w]+=_times[s];
+			}
+			//subtrees that are adjacent in the tree are solved one after the other
+			for(std::vector<int> &l:lists)
+				std::sort(l.begin(),l.end());
+		}
+		return lists;
+	}
+
+private:
+	int _split_depth;
+	std::vector<int> _shape;
+	std::vector<double> _times;		//usecs
+	std::map<int,std::vector<std::vector<int>>> _assignments;		//by number of workers
+};
+
+#endif // DAC_SCHEDULE_HPP
@@ -0,0 +1,424 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Multi-tenant scheduler: a single pool of workers shared by DAC jobs submitted by different callers
+ (and threads), each one with a weight.
+
+ Jobs are chosen by weighted fair share (start time fair queueing): each job has a virtual time,
+ advanced by the execution time of its tasks divided by its weight, and a worker chooses the job with
+ the smallest virtual time among the ones with ready tasks. A job with weight 10 gets ten times the
+ worker time of a job with weight 1 while both have work; a new job starts from the smallest virtual
+ time of the active jobs, so it cannot be starved by the ones already running.
+
+ Each job has a deque of tasks per worker, with its own lock: a worker pushes the children it spawns
+ on its deque of the job and pops them last in first out (depth first), stealing the oldest tasks of
+ the other deques of the job when its own is empty. The choice of the job (a scan of the active jobs,
+ under the lock of the scheduler) is made only when the deque of the worker is empty, or when its job
+ has received DAC_SCHEDULER_QUANTUM (virtual) usecs more than the least served job. Idle workers sleep
+ on a condition variable.
+
+ The nodes of a job are solved by continuation passing: a node spawns its children and returns, the
+ worker that completes its last child executes its combine. No worker ever blocks waiting for children.
+*/
+
+#ifndef DAC_SCHEDULER_HPP
+#define DAC_SCHEDULER_HPP
+
+#include <vector>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <deque>
+#include <limits>
+
+#define DAC_SCHEDULER_QUANTUM 1000		//usecs of virtual time a job can get over the least served one
+
+class DacScheduler;
+
+//tasks of a job pushed by a worker
+struct DacTaskQueue{
+	std::mutex mutex;
+	std::deque<std::function<void()>> tasks;
+};
+
+/**
+ * A job submitted to the scheduler: it can be waited by the caller
+ */
+class DacJob{
+
+public:
+
+	DacJob(DacScheduler *scheduler, double weight):
+		_scheduler(scheduler), _weight(weight>0?weight:1), _vtime(0), _ready(0), _done(false)
+	{}
+
+	virtual ~DacJob()
+	{}
+
+	/**
+	 * @brief wait blocks the caller until the job has been completed
+	 */
+	void wait();
+
+	double weight() const
+	{
+		return _weight;
+	}
+
+protected:
+
+	//adds tasks to the job: the last one is served first
+	void push(std::vector<std::function<void()>> &tasks);
+
+	//called by the task that completes the job
+	void finish();
+
+	DacScheduler *_scheduler;
+
+private:
+
+	friend class DacScheduler;
+
+	double vtime() const
+	{
+		return _vtime.load(std::memory_order_relaxed);
+	}
+
+	void addTime(double usecs)
+	{
+		double v=_vtime.load(std::memory_order_relaxed);
+		while(!_vtime.compare_exchange_weak(v,v+usecs/_weight,std::memory_order_relaxed));
+	}
+
+	double _weight;
+	std::atomic<double> _vtime;		//virtual time: worker time received, divided by the weight
+	std::vector<std::unique_ptr<DacTaskQueue>> _queues;		//one per worker, the last one for the other threads
+	std::atomic<long> _ready;		//tasks in the queues
+	bool _done;
+	std::condition_variable _completed;
+};
+
+
+/*
+ * DAC computation executed as a job: a node is a task, it is combined by the worker completing its last child
+ */
+template<typename OperandType,typename ResultType>
+class DacTreeJob: public DacJob{
+
+public:
+
+	DacTreeJob(DacScheduler *scheduler, double weight,
+			   const std::function<void(const OperandType&,std::vector<OperandType>&)>& divide_fn,
+			   const std::function<void(std::vector<ResultType>&,ResultType&)>& combine_fn,
+			   const std::function<void(const OperandType&, ResultType&)>& seq_fn,
+			   const std::function<bool(const OperandType&)>& cond_fn):
+				DacJob(scheduler,weight), _divide_fn(divide_fn), _combine_fn(combine_fn), _seq_fn(seq_fn), _condition_fn(cond_fn)
+	{}
+
+	void start(const OperandType &op, ResultType &res)
+	{
+		Node *root=new Node(&op,&res,nullptr);
+		std::vector<std::function<void()>> tasks{[this,root]{ solve(root); }};
+		push(tasks);
+	}
+
+private:
+
+	struct Node{
+		const OperandType *op;
+		ResultType *res;
+		Node *parent;
+		std::vector<OperandType> ops;
+		std::vector<ResultType> ress;
+		std::atomic<int> pending;		//children not yet completed
+
+		Node(const OperandType *o, ResultType *r, Node *p): op(o), res(r), parent(p), pending(0)
+		{}
+	};
+
+	void solve(Node *node)
+	{
+		if(_condition_fn(*node->op))
+		{
+			_seq_fn(*node->op,*node->res);
+			completed(node);
+			return;
+		}
+		_divide_fn(*node->op,node->ops);
+		int branch_factor=node->ops.size();
+		node->ress.resize(branch_factor);
+		node->pending.store(branch_factor,std::memory_order_relaxed);
+
+		//pushed in reverse order: the first child is served first
+		std::vector<std::function<void()>> tasks;
+		for(int i=branch_factor-1;i>=0;i--)
+		{
+			Node *child=new Node(&node->ops[i],&node->ress[i],node);
+			tasks.push_back([this,child]{ solve(child); });
+		}
+		push(tasks);
+	}
+
+	//climbs the tree combining the nodes whose children have all completed
+	void completed(Node *node)
+	{
+		while(node->parent)
+		{
+			Node *parent=node->parent;
+			delete node;
+			if(parent->pending.fetch_sub(1,std::memory_order_acq_rel)!=1)
+				return;
+			_combine_fn(parent->ress,*parent->res);
+			node=parent;
+		}
+		delete node;
+		finish();
+	}
+
+	const std::function<void(const OperandType&,std::vector<OperandType>&)>& _divide_fn;
+	const std::function<void(std::vector<ResultType>&,ResultType&)>& _combine_fn;
+	const std::function<void(const OperandType&, ResultType&)>& _seq_fn;
+	const std::function<bool(const OperandType&)>& _condition_fn;
+};
+
+
+class DacScheduler{
+
+public:
+
+	DacScheduler(int nworkers): _nworkers(std::max(nworkers,1)), _vtime(0), _min_vtime(0), _ready(0), _sleeping(0), _stop(false)
+	{
+		for(int i=0;i<_nworkers;i++)
+			_workers.push_back(std::thread(&DacScheduler::worker,this,i));
+	}
+
+	/**
+	 * @brief the jobs still running are completed before the workers are stopped
+	 */
+	~DacScheduler()
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_idle.wait(lock,[this]{ return _jobs.empty(); });
+			_stop=true;
+		}
+		_work.notify_all();
+		for(std::thread &t:_workers)
+			t.join();
+	}
+
+	/**
+	 * @brief submit starts a DAC computation with the given weight, it can be called by any thread.
+	 * The functions, the operand and the result are used by the workers until the job has been waited
+	 */
+	template<typename OperandType,typename ResultType>
+	std::shared_ptr<DacJob> submit(const std::function<void(const OperandType&,std::vector<OperandType>&)>& divide_fn,
+								   const std::function<void(std::vector<ResultType>&,ResultType&)>& combine_fn,
+								   const std::function<void(const OperandType&, ResultType&)>& seq_fn,
+								   const std::function<bool(const OperandType&)>& cond_fn,
+								   const OperandType& op, ResultType& res, double weight=1)
+	{
+		std::shared_ptr<DacTreeJob<OperandType,ResultType>> job(new DacTreeJob<OperandType,ResultType>(this,weight,divide_fn,combine_fn,seq_fn,cond_fn));
+		for(int i=0;i<=_nworkers;i++)
+			job->_queues.push_back(std::unique_ptr<DacTaskQueue>(new DacTaskQueue()));
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			job->_vtime.store(_vtime);
+			_jobs.push_back(job);
+		}
+		job->start(op,res);
+		return job;
+	}
+
+private:
+
+	friend class DacJob;
+
+	//scheduler and index of the worker running on this thread
+	static std::pair<DacScheduler*,int>& currentWorker()
+	{
+		static thread_local std::pair<DacScheduler*,int> current(nullptr,-1);
+		return current;
+	}
+
+	void push(DacJob *job, std::vector<std::function<void()>> &tasks)
+	{
+		int w=currentWorker().first==this ? currentWorker().second : _nworkers;
+		DacTaskQueue &q=*job->_queues[w];
+		{
+			std::lock_guard<std::mutex> lock(q.mutex);
+			for(std::function<void()> &t:tasks)
+				q.tasks.push_back(std::move(t));
+		}
+		job->_ready.fetch_add(tasks.size());
+		_ready.fetch_add(tasks.size());
+		//a worker going to sleep checks _ready after announcing itself in _sleeping
+		if(_sleeping.load()>0)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if(tasks.size()>1)
+				_work.notify_all();
+			else
+				_work.notify_one();
+		}
+	}
+
+	void finish(DacJob *job)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.erase(std::find_if(_jobs.begin(),_jobs.end(),[job](const std::shared_ptr<DacJob> &j){ return j.get()==job; }));
+		job->_done=true;
+		job->_completed.notify_all();
+		if(_jobs.empty())
+			_idle.notify_all();
+	}
+
+	void wait(DacJob *job)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		job->_completed.wait(lock,[job]{ return job->_done; });
+	}
+
+	//the newest task of the deque of worker w
+	bool popLocal(DacJob *job, int w, std::function<void()> &task)
+	{
+		DacTaskQueue &q=*job->_queues[w];
+		{
+			std::lock_guard<std::mutex> lock(q.mutex);
+			if(q.tasks.empty())
+				return false;
+			task=std::move(q.tasks.back());
+			q.tasks.pop_back();
+		}
+		job->_ready.fetch_sub(1);
+		_ready.fetch_sub(1);
+		return true;
+	}
+
+	//the oldest task of another deque of the job
+	bool steal(DacJob *job, int w, std::function<void()> &task)
+	{
+		int n=job->_queues.size();
+		for(int i=1;i<n;i++)
+		{
+			DacTaskQueue &q=*job->_queues[(w+i)%n];
+			{
+				std::lock_guard<std::mutex> lock(q.mutex);
+				if(q.tasks.empty())
+					continue;
+				task=std::move(q.tasks.front());
+				q.tasks.pop_front();
+			}
+			job->_ready.fetch_sub(1);
+			_ready.fetch_sub(1);
+			return true;
+		}
+		return false;
+	}
+
+	//the job with ready tasks and the smallest virtual time: waits until there is one, null if stopped
+	std::shared_ptr<DacJob> nextJob()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		while(true)
+		{
+			std::shared_ptr<DacJob> next;
+			double min_vtime=std::numeric_limits<double>::max();
+			for(const std::shared_ptr<DacJob> &j:_jobs)
+			{
+				min_vtime=std::min(min_vtime,j->vtime());
+				if(j->_ready.load()>0 && (!next || j->vtime()<next->vtime()))
+					next=j;
+			}
+			//virtual time of the scheduler: the one of the least served active job
+			if(!_jobs.empty())
+				_vtime=std::max(_vtime,min_vtime);
+			if(next)
+			{
+				_min_vtime.store(next->vtime(),std::memory_order_relaxed);
+				return next;
+			}
+			if(_stop)
+				return nullptr;
+			_sleeping.fetch_add(1);
+			if(_ready.load()==0)
+				_work.wait(lock);
+			_sleeping.fetch_sub(1);
+		}
+	}
+
+	void worker(int w)
+	{
+		currentWorker()=std::make_pair(this,w);
+		std::shared_ptr<DacJob> job;
+		std::function<void()> task;
+		while(true)
+		{
+			//the worker goes on with its own tasks while its job has not received more than its share
+			bool local=job && job->vtime()<_min_vtime.load(std::memory_order_relaxed)+DAC_SCHEDULER_QUANTUM && popLocal(job.get(),w,task);
+			if(!local)
+			{
+				job=nextJob();
+				if(!job)
+					return;
+				if(!popLocal(job.get(),w,task) && !steal(job.get(),w,task))
+					continue;
+			}
+
+			std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+			task();
+			task=nullptr;
+			job->addTime(std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count());
+		}
+	}
+
+	int _nworkers;
+	std::mutex _mutex;		//jobs list, virtual time of the scheduler, sleeping workers
+	std::condition_variable _work;
+	std::condition_variable _idle;
+	std::vector<std::thread> _workers;
+	std::vector<std::shared_ptr<DacJob>> _jobs;		//active jobs
+	double _vtime;		//virtual time given to the new jobs
+	std::atomic<double> _min_vtime;		//virtual time of the job chosen last: the least served one with ready tasks
+	std::atomic<long> _ready;		//tasks in the queues of all the jobs
+	std::atomic<int> _sleeping;		//workers waiting for tasks
+	bool _stop;
+};
+
+
+inline void DacJob::wait()
+{
+	_scheduler->wait(this);
+}
+
+inline void DacJob::push(std::vector<std::function<void()>> &tasks)
+{
+	_scheduler->push(this,tasks);
+}
+
+inline void DacJob::finish()
+{
+	_scheduler->finish(this);
+}
+
+#endif // DAC_SCHEDULER_HPP
@@ -0,0 +1,293 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Per-worker scratch memory for the user functions (divide, combine, base case), with any backend.
+
+ Large temporaries allocated and freed at every node cost allocator calls and, above all, page faults:
+ the allocator returns them to the system and the next node touches fresh pages again. The scratch
+ memory of a worker is allocated once and reused:
+ - a frame (DacScratchFrame) gives temporaries that live during a call of a user function: they are
+   carved out of a growable arena of the worker and released, all together, when the frame goes out of
+   scope, i.e. when the function returns. The arena keeps its largest chunk for the next calls;
+ - acquire/release recycle blocks that outlive the call (e.g. subproblems built by the divide and freed
+   when the child has been solved): released blocks are cached by the releasing worker and given to the
+   next acquire of the same size.
+ All the memory is aligned to DAC_SCRATCH_ALIGNMENT bytes and it is not initialized.
+
+ The cache of each worker holds at most cacheLimit() bytes (DAC_SCRATCH_CACHE_BYTES by default, see
+ setCacheLimit): a computation with a memory budget has to leave them out of it (pardegree times the
+ limit). The cached blocks are kept across computations, to be reused by the next ones; trim and trimAll
+ free them on request.
+*/
+
+#ifndef DAC_SCRATCH_HPP
+#define DAC_SCRATCH_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <stdlib.h>
+
+#ifndef DAC_SCRATCH_CACHE_BYTES
+#define DAC_SCRATCH_CACHE_BYTES (16L<<20)
+#endif
+#define DAC_SCRATCH_ALIGNMENT 64
+#define DAC_SCRATCH_MIN_CHUNK (64L<<10)
+
+class DacScratch{
+
+public:
+
+	/**
+	 * @brief local the scratch memory of the calling worker
+	 */
+	static DacScratch& local()
+	{
+		static thread_local DacScratch scratch;
+		return scratch;
+	}
+
+	/**
+	 * @brief setCacheLimit bytes of released blocks kept by each worker (0: none is kept)
+	 */
+	static void setCacheLimit(size_t bytes)
+	{
+		limit().store(bytes);
+	}
+
+	static size_t cacheLimit()
+	{
+		return limit().load();
+	}
+
+	/**
+	 * @brief trimAll frees the blocks cached by all the workers (also the ones used by running computations:
+	 * they allocate new blocks)
+	 */
+	static void trimAll()
+	{
+		std::lock_guard<std::mutex> lock(registryMutex());
+		for(DacScratch *s:registry())
+			s->trim();
+	}
+
+	~DacScratch()
+	{
+		{
+			std::lock_guard<std::mutex> lock(registryMutex());
+			std::vector<DacScratch*> &r=registry();
+			r.erase(std::find(r.begin(),r.end(),this));
+		}
+		trim();
+		for(Chunk &c:_chunks)
+			free(c.base);
+	}
+
+	/**
+	 * @brief trim frees the blocks cached by this worker
+	 */
+	void trim()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for(auto &blocks:_cache)
+			for(void *b:blocks.second)
+				free(b);
+		_cache.clear();
+		_cached=0;
+	}
+
+	/**
+	 * @brief acquire a block of n elements: a cached one of the same size if any
+	 */
+	template<typename T>
+	T* acquire(size_t n)
+	{
+		size_t bytes=roundUp(n*sizeof(T));
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			auto it=_cache.find(bytes);
+			if(it!=_cache.end() && !it->second.empty())
+			{
+				void *b=it->second.back();
+				it->second.pop_back();
+				_cached-=bytes;
+				return static_cast<T*>(b);
+			}
+		}
+		return static_cast<T*>(alignedAlloc(bytes));
+	}
+
+	/**
+	 * @brief release a block of n elements obtained by acquire (possibly on another worker)
+	 */
+	template<typename T>
+	void release(T *p, size_t n)
+	{
+		if(p==nullptr)
+			return;
+		size_t bytes=roundUp(n*sizeof(T));
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if(_cached+bytes<=cacheLimit())
+			{
+				_cache[bytes].push_back(p);
+				_cached+=bytes;
+				return;
+			}
+		}
+		free(p);
+	}
+
+private:
+
+	friend class DacScratchFrame;
+
+	struct Chunk{
+		char *base;
+		size_t size;
+	};
+
+	//position in the arena
+	struct Mark{
+		size_t chunk;
+		size_t offset;
+	};
+
+	DacScratch(): _current(0), _offset(0), _cached(0)
+	{
+		std::lock_guard<std::mutex> lock(registryMutex());
+		registry().push_back(this);
+	}
+
+	//function statics: the header can be included by several translation units
+	static std::atomic<size_t>& limit()
+	{
+		static std::atomic<size_t> bytes(DAC_SCRATCH_CACHE_BYTES);
+		return bytes;
+	}
+
+	//the scratch memories of the live workers
+	static std::vector<DacScratch*>& registry()
+	{
+		static std::vector<DacScratch*> scratches;
+		return scratches;
+	}
+
+	static std::mutex& registryMutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	static size_t roundUp(size_t bytes)
+	{
+		return (bytes+DAC_SCRATCH_ALIGNMENT-1)/DAC_SCRATCH_ALIGNMENT*DAC_SCRATCH_ALIGNMENT;
+	}
+
+	static void *alignedAlloc(size_t bytes)
+	{
+		void *p=nullptr;
+		if(posix_memalign(&p,DAC_SCRATCH_ALIGNMENT,bytes>0?bytes:DAC_SCRATCH_ALIGNMENT)!=0)
+			throw std::bad_alloc();
+		return p;
+	}
+
+	void *arenaAllocate(size_t bytes)
+	{
+		bytes=roundUp(bytes);
+		//the chunks after the current one are free: use the first one large enough, or add a new one
+		while(_current<_chunks.size() && _offset+bytes>_chunks[_current].size)
+		{
+			_current++;
+			_offset=0;
+		}
+		if(_current==_chunks.size())
+		{
+			size_t size=std::max(bytes,_chunks.empty() ? (size_t)DAC_SCRATCH_MIN_CHUNK : 2*_chunks.back().size);
+			_chunks.push_back({static_cast<char*>(alignedAlloc(size)),size});
+		}
+		void *p=_chunks[_current].base+_offset;
+		_offset+=bytes;
+		return p;
+	}
+
+	Mark mark() const
+	{
+		return {_current,_offset};
+	}
+
+	void reset(const Mark &m)
+	{
+		_current=m.chunk;
+		_offset=m.offset;
+		if(_current==0 && _offset==0 && _chunks.size()>1)
+		{
+			//the arena is empty: only the largest chunk (the last one) is kept, its pages have already been touched
+			for(size_t i=0;i<_chunks.size()-1;i++)
+				free(_chunks[i].base);
+			_chunks.erase(_chunks.begin(),_chunks.end()-1);
+		}
+	}
+
+	//arena of the frames: used only by the owner thread
+	std::vector<Chunk> _chunks;
+	size_t _current;		//chunk being used by the arena
+	size_t _offset;
+
+	std::mutex _mutex;		//the cache is emptied by trimAll from any thread
+	std::unordered_map<size_t,std::vector<void*>> _cache;	//released blocks, by size
+	size_t _cached;		//bytes in the cache
+};
+
+/**
+ * Temporaries of a call of a user function: they are released when the frame goes out of scope.
+ * Frames can be nested, the inner one must end first
+ */
+class DacScratchFrame{
+
+public:
+
+	DacScratchFrame(): _scratch(DacScratch::local()), _mark(_scratch.mark())
+	{}
+
+	~DacScratchFrame()
+	{
+		_scratch.reset(_mark);
+	}
+
+	DacScratchFrame(const DacScratchFrame&)=delete;
+	DacScratchFrame& operator=(const DacScratchFrame&)=delete;
+
+	/**
+	 * @brief allocate space for n elements (not initialized)
+	 */
+	template<typename T>
+	T* allocate(size_t n)
+	{
+		return static_cast<T*>(_scratch.arenaAllocate(n*sizeof(T)));
+	}
+
+private:
+	DacScratch &_scratch;
+	DacScratch::Mark _mark;
+};
+
+#endif // DAC_SCRATCH_HPP
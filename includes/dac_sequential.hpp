@@ -0,0 +1,115 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Sequential backend of the DAC pattern: plain recursion, without any parallel runtime.
+
+ It is the baseline (T1) for measuring speedups and it is used by the parallel
+ backends when they are asked to run with a single worker.
+*/
+
+#ifndef DAC_SEQUENTIAL_HPP
+#define DAC_SEQUENTIAL_HPP
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include "dac_explicit_stack.hpp"
+
+template<typename OperandType,typename ResultType>
+class DacSequential{
+
+public:
+
+	DacSequential(const std::function<void(const OperandType&,std::vector<OperandType>&)>& divide_fn,
+			  const std::function<void(std::vector<ResultType>&,ResultType&)>& combine_fn,
+			  const std::function<void(const OperandType&, ResultType&)>& seq_fn,
+			  const std::function<bool(const OperandType&)>& cond_fn, const OperandType& op, ResultType& res):
+				_divide_fn(divide_fn), _combine_fn(combine_fn), _seq_fn(seq_fn), _condition_fn(cond_fn), _op(&op), _res(&res), _max_depth(DAC_MAX_RECURSION_DEPTH)
+	{}
+
+	/**
+	 * @brief setMaxRecursionDepth nodes deeper than depth are solved using an explicit stack,
+	 * so native stack usage is bounded whatever is the shape of the tree. <=0: no limit
+	 */
+	void setMaxRecursionDepth(int depth)
+	{
+		_max_depth=depth;
+	}
+
+	void compute()
+	{
+		recursiveDac(_op,_res,0);
+	}
+
+
+private:
+
+	//subproblems and partial results of the node being solved at a given depth
+	struct Level{
+		std::vector<OperandType> ops;
+		std::vector<ResultType> ress;
+	};
+
+	void recursiveDac(const OperandType *op, ResultType *ret, int depth)
+	{
+		if(_max_depth>0 && depth>=_max_depth)
+		{
+			//too deep: go on without recursion
+			DacExplicitStack<OperandType,ResultType> stack(_divide_fn,_combine_fn,_seq_fn,_condition_fn);
+			stack.compute(op,ret);
+		}
+		else if(!_condition_fn(*op)) //not the base case
+		{
+			//vectors are reused by all the nodes at the same depth: no allocations once they are big enough
+			if((int)_levels.size()<=depth)
+				_levels.resize(depth+1);
+			Level &level=_levels[depth];
+
+			//divide
+			_divide_fn(*op,level.ops);
+			int branch_factor=level.ops.size();
+			level.ress.resize(branch_factor);
+
+			for(int i=0;i<branch_factor;i++)
+				recursiveDac(&level.ops[i],&level.ress[i],depth+1);
+
+			//combine results
+			_combine_fn(level.ress,*ret);
+
+			level.ops.clear();
+			level.ress.clear();
+		}
+		else
+		{
+			_seq_fn(*op,*ret);
+		}
+	}
+
+	//function pointers
+	const std::function<void(const OperandType&,std::vector<OperandType>&)>& _divide_fn;
+	const std::function<void(std::vector<ResultType>&,ResultType&)>& _combine_fn;
+	const std::function<void(const OperandType& ,  ResultType&)>& _seq_fn;
+	const std::function<bool(const OperandType&)>& _condition_fn;
+	const OperandType* _op;
+	ResultType* _res;
+
+	int _max_depth;
+	std::deque<Level> _levels;		//a deque: references to the levels stay valid while it grows
+};
+
+#endif // DAC_SEQUENTIAL_HPP
@@ -0,0 +1,305 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Merge of two sorted runs of 32 bit integer keys with vector instructions.
+
+ The scalar merge is bound by branch mispredictions on random keys. Here the runs are merged W keys
+ at a time (W=8 with AVX2, 16 with AVX-512) by a bitonic merge network in registers: the network
+ merges the W keys carried from the previous step with the next W keys of the run whose head is the
+ smallest, the lower half is stored and the upper half is carried to the next step. No branch depends
+ on the comparisons of the keys, except the one choosing the next run. When a run has less than W
+ keys left the rest is merged by scalar code.
+
+ The instruction set is chosen at runtime, on the first call, among the ones supported by the CPU
+ (AVX-512, AVX2, otherwise the scalar merge); the DAC_SIMD_MERGE environment variable (avx512, avx2,
+ scalar) can restrict it. The vector code is compiled with the GCC target pragma, so the program does
+ not need to be compiled for a specific CPU.
+*/
+
+#ifndef DAC_SIMD_MERGE_HPP
+#define DAC_SIMD_MERGE_HPP
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define DAC_SIMD_MERGE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace dac_simd{
+
+/**
+ * @brief scalarMerge merges [x,xe) and [y,ye) into z (ties are taken from x)
+ */
+template<typename T>
+void scalarMerge(const T *x, const T *xe, const T *y, const T *ye, T *z)
+{
+	while(x<xe && y<ye)
+	{
+		if(*y<*x)
+			*z++=*y++;
+		else
+			*z++=*x++;
+	}
+	while(x<xe)
+		*z++=*x++;
+	while(y<ye)
+		*z++=*y++;
+}
+
+//run giving the next block of w keys (the one with the smallest head): null if it has less than w keys
+template<typename T>
+inline const T** nextBlock(const T **x, const T *xe, const T **y, const T *ye, int w)
+{
+	const T **next=(*y<ye && (*x>=xe || **y<**x)) ? y : x;
+	return ((next==x ? xe : ye)-*next>=w) ? next : nullptr;
+}
+
+//last step: the w carried keys are merged with what is left of the runs
+template<typename T>
+void mergeTail(const T *carried, int w, const T *x, const T *xe, const T *y, const T *ye, T *z)
+{
+	const T *c=carried, *ce=carried+w;
+	while(c<ce)
+	{
+		//the smallest among the three heads: the carried keys go first on ties
+		if(x<xe && *x<*c && (y>=ye || !(*y<*x)))
+			*z++=*x++;
+		else if(y<ye && *y<*c)
+			*z++=*y++;
+		else
+			*z++=*c++;
+	}
+	scalarMerge(x,xe,y,ye,z);
+}
+
+#if DAC_SIMD_MERGE_X86
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+/*
+ * AVX2: 8 keys per register. clean sorts a bitonic register by comparing lanes at distance 4, 2, 1
+ * (the lower lane of each pair takes the minimum)
+ */
+struct Avx2Int{
+	typedef int T;
+	typedef __m256i V;
+	static const int width=8;
+
+	static V load(const T *p)
+	{
+		return _mm256_loadu_si256((const __m256i*)p);
+	}
+
+	static void store(T *p, V v)
+	{
+		_mm256_storeu_si256((__m256i*)p,v);
+	}
+
+	static V clean(V v)
+	{
+		V p=_mm256_permute2x128_si256(v,v,1);
+		v=_mm256_blend_epi32(_mm256_min_epi32(v,p),_mm256_max_epi32(v,p),0xF0);
+		p=_mm256_shuffle_epi32(v,_MM_SHUFFLE(1,0,3,2));
+		v=_mm256_blend_epi32(_mm256_min_epi32(v,p),_mm256_max_epi32(v,p),0xCC);
+		p=_mm256_shuffle_epi32(v,_MM_SHUFFLE(2,3,0,1));
+		return _mm256_blend_epi32(_mm256_min_epi32(v,p),_mm256_max_epi32(v,p),0xAA);
+	}
+
+	//a and b sorted: a gets the lower 8 keys, b the upper 8, both sorted
+	static void merge(V &a, V &b)
+	{
+		b=_mm256_permutevar8x32_epi32(b,_mm256_setr_epi32(7,6,5,4,3,2,1,0));
+		V l=_mm256_min_epi32(a,b);
+		V h=_mm256_max_epi32(a,b);
+		a=clean(l);
+		b=clean(h);
+	}
+};
+
+template<typename Ops>
+void mergeAvx2(const typename Ops::T *x, const typename Ops::T *xe, const typename Ops::T *y, const typename Ops::T *ye, typename Ops::T *z)
+{
+	typedef typename Ops::T T;
+	const int w=Ops::width;
+	if(xe-x<w || ye-y<w)
+	{
+		scalarMerge(x,xe,y,ye,z);
+		return;
+	}
+	typename Ops::V a=Ops::load(x);
+	typename Ops::V b=Ops::load(y);
+	x+=w;
+	y+=w;
+	while(true)
+	{
+		Ops::merge(a,b);
+		Ops::store(z,a);
+		z+=w;
+		const T **next=nextBlock(&x,xe,&y,ye,w);
+		if(!next)
+			break;
+		a=Ops::load(*next);
+		*next+=w;
+	}
+	T carried[w];
+	Ops::store(carried,b);
+	mergeTail(carried,w,x,xe,y,ye,z);
+}
+
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+
+/*
+ * AVX-512: 16 keys per register, lanes compared at distance 8, 4, 2, 1. The zero masking forms (with all the
+ * lanes selected) are used: the plain ones pass an undefined register to the builtins, that -Wall reports as
+ * maybe uninitialized
+ */
+struct Avx512Int{
+	typedef int T;
+	typedef __m512i V;
+	static const int width=16;
+	static const __mmask16 all=0xFFFF;
+
+	static V load(const T *p)
+	{
+		return _mm512_loadu_si512(p);
+	}
+
+	static void store(T *p, V v)
+	{
+		_mm512_storeu_si512(p,v);
+	}
+
+	//upper: lanes taking the maximum of their pair
+	static V exchange(V v, V p, __mmask16 upper)
+	{
+		return _mm512_mask_max_epi32(_mm512_maskz_min_epi32(all,v,p),upper,v,p);
+	}
+
+	static V clean(V v)
+	{
+		v=exchange(v,_mm512_maskz_shuffle_i32x4(all,v,v,_MM_SHUFFLE(1,0,3,2)),0xFF00);
+		v=exchange(v,_mm512_maskz_shuffle_i32x4(all,v,v,_MM_SHUFFLE(2,3,0,1)),0xF0F0);
+		v=exchange(v,_mm512_maskz_shuffle_epi32(all,v,(_MM_PERM_ENUM)_MM_SHUFFLE(1,0,3,2)),0xCCCC);
+		return exchange(v,_mm512_maskz_shuffle_epi32(all,v,(_MM_PERM_ENUM)_MM_SHUFFLE(2,3,0,1)),0xAAAA);
+	}
+
+	static void merge(V &a, V &b)
+	{
+		b=_mm512_maskz_permutexvar_epi32(all,_mm512_setr_epi32(15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0),b);
+		V l=_mm512_maskz_min_epi32(all,a,b);
+		V h=_mm512_maskz_max_epi32(all,a,b);
+		a=clean(l);
+		b=clean(h);
+	}
+};
+
+template<typename Ops>
+void mergeAvx512(const typename Ops::T *x, const typename Ops::T *xe, const typename Ops::T *y, const typename Ops::T *ye, typename Ops::T *z)
+{
+	typedef typename Ops::T T;
+	const int w=Ops::width;
+	if(xe-x<w || ye-y<w)
+	{
+		scalarMerge(x,xe,y,ye,z);
+		return;
+	}
+	typename Ops::V a=Ops::load(x);
+	typename Ops::V b=Ops::load(y);
+	x+=w;
+	y+=w;
+	while(true)
+	{
+		Ops::merge(a,b);
+		Ops::store(z,a);
+		z+=w;
+		const T **next=nextBlock(&x,xe,&y,ye,w);
+		if(!next)
+			break;
+		a=Ops::load(*next);
+		*next+=w;
+	}
+	T carried[w];
+	Ops::store(carried,b);
+	mergeTail(carried,w,x,xe,y,ye,z);
+}
+
+#pragma GCC pop_options
+
+#endif // DAC_SIMD_MERGE_X86
+
+enum Isa{
+	SCALAR,
+	AVX2,
+	AVX512
+};
+
+//the best instruction set supported by the CPU (and allowed by DAC_SIMD_MERGE)
+inline Isa selectIsa()
+{
+	const char *env=getenv("DAC_SIMD_MERGE");
+	bool scalar_only=(env && strcmp(env,"scalar")==0);
+	bool avx2_only=(env && strcmp(env,"avx2")==0);
+#if DAC_SIMD_MERGE_X86
+	__builtin_cpu_init();
+	if(!scalar_only && !avx2_only && __builtin_cpu_supports("avx512f"))
+		return AVX512;
+	if(!scalar_only && __builtin_cpu_supports("avx2"))
+		return AVX2;
+#else
+	(void)scalar_only;
+	(void)avx2_only;
+#endif
+	return SCALAR;
+}
+
+inline Isa isa()
+{
+	static const Isa selected=selectIsa();
+	return selected;
+}
+
+} // namespace dac_simd
+
+/**
+ * @brief dacMerge merges the sorted runs [x,xe) and [y,ye) into z, with the best instruction set available
+ */
+inline void dacMerge(const int *x, const int *xe, const int *y, const int *ye, int *z)
+{
+#if DAC_SIMD_MERGE_X86
+	switch(dac_simd::isa())
+	{
+		case dac_simd::AVX512:
+			dac_simd::mergeAvx512<dac_simd::Avx512Int>(x,xe,y,ye,z);
+			return;
+		case dac_simd::AVX2:
+			dac_simd::mergeAvx2<dac_simd::Avx2Int>(x,xe,y,ye,z);
+			return;
+		default:
+			break;
+	}
+#endif
+	dac_simd::scalarMerge(x,xe,y,ye,z);
+}
+
+#endif // DAC_SIMD_MERGE_HPP
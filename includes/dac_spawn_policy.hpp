@@ -0,0 +1,58 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Spawn policies of the task based backends.
+
+ - help first: all the children of a node are spawned as tasks, then the parent waits for them.
+   Work is exposed to the other workers as soon as possible (good for wide nodes, e.g. strassen);
+ - work first: all the children but the last one are spawned, the last one is executed
+   by the parent itself, that saves a task per node (good for binary trees, e.g. the sorts);
+ - hybrid: help first up to a given depth, to quickly feed all the workers, work first below it.
+
+ Wide nodes (more than DAC_TREE_SPAWN_THRESHOLD children, e.g. the buckets of a sample sort) do not
+ spawn their children in a loop, that would keep the parent busy issuing thousands of tasks while the
+ other workers wait: the range of the children is halved by tasks until it has at most DAC_TREE_SPAWN_GRAIN
+ children, which are then spawned. Each task of this spawning tree waits for its own children only,
+ so the join is a tree as well. All the children of a wide node are spawned, whatever the policy.
+*/
+
+#ifndef DAC_SPAWN_POLICY_HPP
+#define DAC_SPAWN_POLICY_HPP
+
+#ifndef DAC_TREE_SPAWN_THRESHOLD
+#define DAC_TREE_SPAWN_THRESHOLD 64
+#endif
+#ifndef DAC_TREE_SPAWN_GRAIN
+#define DAC_TREE_SPAWN_GRAIN 16
+#endif
+
+enum DacSpawnPolicy{
+	DAC_HELP_FIRST,
+	DAC_WORK_FIRST,
+	DAC_HYBRID
+};
+
+/**
+ * @brief dacInlineLastChild true if a node at the given depth executes its last child inline
+ */
+inline bool dacInlineLastChild(DacSpawnPolicy policy, int hybrid_depth, int depth)
+{
+	return policy==DAC_WORK_FIRST || (policy==DAC_HYBRID && depth>=hybrid_depth);
+}
+
+#endif // DAC_SPAWN_POLICY_HPP
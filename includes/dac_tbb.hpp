@@ -27,8 +27,21 @@
 
 #include <vector>
 #include <functional>
+#include <memory>
+#include <atomic>
 #include <tbb/task_scheduler_init.h>
 #include <tbb/task.h>
+#include <tbb/enumerable_thread_specific.h>
+#include "dac_explicit_stack.hpp"
+#include "dac_sequential.hpp"
+#include "dac_memory_budget.hpp"
+#include "dac_leaf_batcher.hpp"
+#include "dac_spawn_policy.hpp"
+#include "dac_work_span.hpp"
+#include "dac_partial_combine.hpp"
+#include "dac_elastic.hpp"
+#include "dac_dag.hpp"
+#include "dac_probes.hpp"
 
 
 
@@ -40,15 +53,30 @@
 
 
 
+template<typename OperandType,typename ResultType>
+class DacTBB;
+
+template<typename OperandType,typename ResultType>
+class DacSpawnRangeTask;
+
 template<typename OperandType,typename ResultType>
 class DacTask :public tbb::task{
 
 public:
-	DacTask(const std::function<void(const OperandType&,std::vector<OperandType>&)>& divide_fn,
-			const std::function<void(std::vector<ResultType>&,ResultType&)>& combine_fn,
-			const std::function<void(const OperandType&, ResultType&)>& seq_fn,
-			const std::function<bool(const OperandType&)>& cond_fn, const OperandType* op, ResultType* res ):
-			  _divide_fn(divide_fn), _combine_fn(combine_fn), _seq_fn(seq_fn), _condition_fn(cond_fn), _op(op), _res(res)
+	typedef typename DacPartialCombine<OperandType,ResultType>::Node PartialCombineNode;
+
+	//children with dependencies of a node: what a child needs to spawn the siblings waiting for it
+	struct DagSiblings{
+		DacDag dag;
+		std::vector<OperandType> *ops;
+		std::vector<ResultType> *ress;
+		std::vector<DacWorkSpan> *children_ws;
+		PartialCombineNode *pc;
+	};
+
+	DacTask(DacTBB<OperandType,ResultType> *dac, const OperandType* op, ResultType* res, int depth, DacWorkSpan *ws=nullptr,
+			PartialCombineNode *parent_pc=nullptr, int child=0):
+			  _dac(dac), _op(op), _res(res), _depth(depth), _ws(ws), _parent_pc(parent_pc), _child(child), _spawned(false), _siblings(nullptr)
 	{
 	}
 
@@ -56,53 +84,335 @@ public:
 	//execute method required by tbb
 	tbb::task* execute()
 	{
-		if(!_condition_fn(*_op)) //not the base case
+		if(_spawned)
+			_dac->taskStarted();
+#if DAC_USDT
+		if(is_stolen_task())
+			DAC_PROBE2(steal,_depth,_dac->probeSize(*_op));
+#endif
+		size_t mem=0;
+		DacWorkSpanTimer timer(_ws!=nullptr);
+		if((_dac->_seq_batch_fn && _depth>=_dac->_batch_depth) || (_dac->_max_depth>0 && _depth>=_dac->_max_depth) || !_dac->reserveMemory(_op,mem))
+		{
+			//batched leaves, too deep or over the memory budget: go on depth first, without recursion
+			DAC_PROBE2(subtree_start,_depth,_dac->probeSize(*_op));
+			_dac->solveDepthFirst(_op,_res);
+			DAC_PROBE2(subtree_end,_depth,_dac->probeSize(*_op));
+			if(_ws)
+				*_ws=DacWorkSpan::leaf(timer.lap());
+		}
+		else if(!_dac->_condition_fn(*_op)) //not the base case
 		{
 			//divide
 			std::vector<OperandType> *ops=new std::vector<OperandType>();
-			_divide_fn(*_op,*ops);
+			_dac->_divide_fn(*_op,*ops);
 			int branch_factor=ops->size();
 
 			//create the space for the partial results
 			std::vector<ResultType> *ress=new std::vector<ResultType>(branch_factor);
+			std::vector<DacWorkSpan> *children_ws=(_ws ? new std::vector<DacWorkSpan>(branch_factor) : nullptr);
+			PartialCombineNode *pc=(_dac->_partial_combine.enabled() ? new PartialCombineNode(_dac->_partial_combine,*_op,*ress,*_res) : nullptr);
+			DagSiblings *siblings=nullptr;
+			if(_dac->_dependencies_fn)
+			{
+				std::vector<std::vector<int>> preds(branch_factor);
+				_dac->_dependencies_fn(*_op,*ops,preds);
+				siblings=new DagSiblings{DacDag(preds),ops,ress,children_ws,pc};
+			}
+			double divide_time=timer.lap();
 
 			//create the tasks
-			//The call to set_ref_count uses k+1 as its argument. The extra 1 is critical. (source [1])
-			this->set_ref_count(branch_factor+1);
-			for(int i=0;i<branch_factor-1;i++)
+			//The ref count is the number of children plus 1. The extra 1 is critical. (source [1])
+			this->set_ref_count(1);
+			bool wide=(!siblings && branch_factor>DAC_TREE_SPAWN_THRESHOLD);
+			bool inline_last=(!siblings && !wide && _dac->inlineLastChild(_depth));
+			if(wide)
 			{
-				tbb::task *t =new (allocate_child()) DacTask(_divide_fn,_combine_fn,_seq_fn,_condition_fn,&(*ops)[i],&(*ress)[i]);
-				spawn(*t);
+				//the children are spawned (and joined) by a tree of tasks
+				DacSpawnRangeTask<OperandType,ResultType> *r=new (allocate_child()) DacSpawnRangeTask<OperandType,ResultType>(_dac,ops,ress,children_ws,pc,0,branch_factor,_depth+1);
+				increment_ref_count();
+				spawn(*r);
 			}
-			//last one
-			tbb::task *t =new (allocate_child()) DacTask(_divide_fn,_combine_fn,_seq_fn,_condition_fn,&(*ops)[branch_factor-1],&(*ress)[branch_factor-1]);
-			spawn_and_wait_for_all(*t);
+			else if(siblings)
+			{
+				//only the roots are spawned here, the other children are added by the ones they depend on
+				for(int i:siblings->dag.roots())
+				{
+					DAC_PROBE2(spawn,_depth+1,_dac->probeSize((*ops)[i]));
+					spawn(*newSibling(*this,siblings,i));	//allocate_additional_child_of increments the ref count
+				}
+			}
+			else
+			{
+				for(int i=0;i<branch_factor;i++)
+				{
+					DacWorkSpan *child_ws=(children_ws ? &(*children_ws)[i] : nullptr);
+					bool last=(inline_last && i==branch_factor-1);
+					if(!last && !_dac->spawnChild())
+					{
+						//no demand for it (or no room, in elastic mode): the child is solved by this worker
+						DacTask *t=new (allocate_root()) DacTask(_dac,&(*ops)[i],&(*ress)[i],_depth+1,child_ws,pc,i);
+						spawn_root_and_wait(*t);
+						continue;
+					}
+					DacTask *t=new (allocate_child()) DacTask(_dac,&(*ops)[i],&(*ress)[i],_depth+1,child_ws,pc,i);
+					t->_spawned=!last;
+					increment_ref_count();
+					if(last)
+						spawn_and_wait_for_all(*t);	//work first: executed next by this thread
+					else
+					{
+						DAC_PROBE2(spawn,_depth+1,_dac->probeSize((*ops)[i]));
+						spawn(*t);
+					}
+				}
+			}
+			if(!inline_last)
+			{
+				//the children with dependencies are not counted by the elastic mode, neither is the wait
+				if(!siblings)
+					_dac->waitStarted();
+				wait_for_all();
+				if(!siblings)
+					_dac->waitEnded();
+			}
+			timer.lap();		//the children have been measured by themselves
 
 
-			//combine results
-			_combine_fn(*ress,*_res);
+			//combine results (with a partial combine all the steps have already been executed)
+			if(pc)
+				delete pc;
+			else
+			{
+				DAC_PROBE2(combine_start,_depth,_dac->probeSize(*_op));
+				_dac->_combine_fn(*ress,*_res);
+				DAC_PROBE2(combine_end,_depth,_dac->probeSize(*_op));
+			}
+			if(_ws)
+			{
+				*_ws=(siblings ? DacWorkSpan::node(divide_time,*children_ws,siblings->dag.preds(),timer.lap())
+							   : DacWorkSpan::node(divide_time,*children_ws,timer.lap()));
+				delete children_ws;
+			}
+			if(siblings)
+				delete siblings;
 
 			//cleanup memory
 
 			delete ops;
 			delete ress;
+			if(mem>0)
+				_dac->_mem_budget.release(mem);
 		}
 		else
 		{
-			_seq_fn(*_op,*_res);
+			DAC_PROBE2(leaf_start,_depth,_dac->probeSize(*_op));
+			_dac->_seq_fn(*_op,*_res);
+			DAC_PROBE2(leaf_end,_depth,_dac->probeSize(*_op));
+			if(_ws)
+				*_ws=DacWorkSpan::leaf(timer.lap());
+		}
+		if(_parent_pc)
+			_parent_pc->childDone(_child);
+		if(_siblings)
+		{
+			//spawn the siblings that were waiting only for this child: the parent is still waiting for
+			//this task, so it cannot complete before they are added to its children
+			std::vector<int> ready;
+			_siblings->dag.completed(_child,ready);
+			for(int s:ready)
+			{
+				DAC_PROBE2(spawn,_depth,_dac->probeSize((*_siblings->ops)[s]));
+				spawn(*newSibling(*parent(),_siblings,s));
+			}
 		}
+		if(_spawned)
+			_dac->taskCompleted();
 		return nullptr;
 	}
 
 private:
 
-	const std::function<void(const OperandType&,std::vector<OperandType>&)>& _divide_fn;
-	const std::function<void(const OperandType& ,  ResultType&)>& _seq_fn;
-	const std::function<void(std::vector<ResultType>&,ResultType&)>& _combine_fn;
-	const std::function<bool(const OperandType&)>& _condition_fn;
+	friend class DacSpawnRangeTask<OperandType,ResultType>;
+
+	//allocate the task of the i-th child of a node with dependencies, as an additional child of the parent task
+	DacTask* newSibling(tbb::task &parent_task, DagSiblings *siblings, int i)
+	{
+		int depth=(&parent_task==this ? _depth+1 : _depth);
+		DacWorkSpan *child_ws=(siblings->children_ws ? &(*siblings->children_ws)[i] : nullptr);
+		DacTask *t=new (allocate_additional_child_of(parent_task)) DacTask(_dac,&(*siblings->ops)[i],&(*siblings->ress)[i],depth,child_ws,siblings->pc,i);
+		t->_siblings=siblings;
+		return t;
+	}
+
+	DacTBB<OperandType,ResultType> *_dac;	//the pattern instance (functions and configuration)
 	const OperandType* _op;
 	ResultType* _res;
+	int _depth;
+	DacWorkSpan *_ws;		//if not null, where the work and span of the subtree are stored
+	PartialCombineNode *_parent_pc;		//if not null, the partial combine to notify at completion
+	int _child;
+	bool _spawned;		//counted by lazy splitting and elastic mode
+	DagSiblings *_siblings;		//if not null, this is a child with dependencies
+
+};
+
+
+/*
+ * Spawns the children in [first,last) of a wide node (see dac_spawn_policy.hpp): the lower half of the
+ * range is given to a new task until at most DAC_TREE_SPAWN_GRAIN children are left. The task completes
+ * when all of them have been solved
+ */
+template<typename OperandType,typename ResultType>
+class DacSpawnRangeTask :public tbb::task{
+
+public:
+	typedef typename DacPartialCombine<OperandType,ResultType>::Node PartialCombineNode;
+
+	DacSpawnRangeTask(DacTBB<OperandType,ResultType> *dac, std::vector<OperandType> *ops, std::vector<ResultType> *ress,
+					  std::vector<DacWorkSpan> *children_ws, PartialCombineNode *pc, int first, int last, int depth):
+			  _dac(dac), _ops(ops), _ress(ress), _children_ws(children_ws), _pc(pc), _first(first), _last(last), _depth(depth)
+	{
+	}
+
+	tbb::task* execute()
+	{
+		this->set_ref_count(1);
+		while(_last-_first>DAC_TREE_SPAWN_GRAIN)
+		{
+			int mid=_first+(_last-_first)/2;
+			DacSpawnRangeTask *r=new (allocate_child()) DacSpawnRangeTask(_dac,_ops,_ress,_children_ws,_pc,_first,mid,_depth);
+			increment_ref_count();
+			spawn(*r);
+			_first=mid;
+		}
+		for(int i=_first;i<_last;i++)
+		{
+			DacWorkSpan *child_ws=(_children_ws ? &(*_children_ws)[i] : nullptr);
+			if(!_dac->spawnChild())
+			{
+				DacTask<OperandType,ResultType> *t=new (allocate_root()) DacTask<OperandType,ResultType>(_dac,&(*_ops)[i],&(*_ress)[i],_depth,child_ws,_pc,i);
+				spawn_root_and_wait(*t);
+				continue;
+			}
+			DacTask<OperandType,ResultType> *t=new (allocate_child()) DacTask<OperandType,ResultType>(_dac,&(*_ops)[i],&(*_ress)[i],_depth,child_ws,_pc,i);
+			t->_spawned=true;
+			increment_ref_count();
+			DAC_PROBE2(spawn,_depth,_dac->probeSize((*_ops)[i]));
+			spawn(*t);
+		}
+		wait_for_all();
+		return nullptr;
+	}
+
+private:
+	DacTBB<OperandType,ResultType> *_dac;
+	std::vector<OperandType> *_ops;
+	std::vector<ResultType> *_ress;
+	std::vector<DacWorkSpan> *_children_ws;
+	PartialCombineNode *_pc;
+	int _first;
+	int _last;
+	int _depth;		//of the children
+};
+
+
+/*
+ * Task of the reduction mode: leaves fold their result into the accumulator of the thread.
+ * A non-leaf task is replaced by an empty continuation (continuation passing style),
+ * so it completes without waiting for its children
+ */
+template<typename OperandType,typename ResultType>
+class DacReduceTask :public tbb::task{
+
+public:
+	DacReduceTask(DacTBB<OperandType,ResultType> *dac, const OperandType* op, int depth):
+			  _dac(dac), _op(op), _depth(depth), _spawned(false)
+	{
+	}
+
+	tbb::task* execute()
+	{
+		if(_spawned)
+			_dac->taskStarted();
+#if DAC_USDT
+		if(is_stolen_task())
+			DAC_PROBE2(steal,_depth,_dac->probeSize(*_op));
+#endif
+		tbb::task *next=nullptr;
+		if((_dac->_seq_batch_fn && _depth>=_dac->_batch_depth) || (_dac->_max_depth>0 && _depth>=_dac->_max_depth))
+		{
+			//batched leaves or too deep: solve the subtree depth first and reduce its result
+			ResultType res;
+			DAC_PROBE2(subtree_start,_depth,_dac->probeSize(*_op));
+			_dac->solveDepthFirst(_op,&res);
+			DAC_PROBE2(subtree_end,_depth,_dac->probeSize(*_op));
+			_dac->_reduce_fn(res,_dac->_accumulators->local());
+		}
+		else if(!_dac->_condition_fn(*_op)) //not the base case
+		{
+			std::vector<OperandType> ops;
+			_dac->_divide_fn(*_op,ops);
+			int branch_factor=ops.size();
 
+			bool inline_last=_dac->inlineLastChild(_depth);
+
+			//lazy splitting and elastic mode: the children without demand (or room) are solved now by this worker
+			std::vector<bool> solved((_dac->_elastic || _dac->_lazy_splitting) ? branch_factor : 0,false);
+			int to_spawn=branch_factor;
+			for(int i=0;i<(int)solved.size();i++)
+			{
+				if(!(inline_last && i==branch_factor-1) && !_dac->spawnChild())
+				{
+					tbb::task *t=new (allocate_root()) DacReduceTask(_dac,new OperandType(std::move(ops[i])),_depth+1);
+					spawn_root_and_wait(*t);
+					solved[i]=true;
+					to_spawn--;
+				}
+			}
+
+			//children own their operands, they are attached to the continuation
+			tbb::empty_task &c=*new (allocate_continuation()) tbb::empty_task;
+			c.set_ref_count(to_spawn);
+			if(to_spawn==0)
+				next=&c;
+			for(int i=0;i<branch_factor;i++)
+			{
+				if(!solved.empty() && solved[i])
+					continue;
+				bool last=(inline_last && i==branch_factor-1);
+				DacReduceTask *t=new (c.allocate_child()) DacReduceTask(_dac,new OperandType(std::move(ops[i])),_depth+1);
+				t->_spawned=(!last && !solved.empty());
+				if(last)
+					next=t;		//work first: the last one is executed next by this thread
+				else
+				{
+					DAC_PROBE2(spawn,_depth+1,_dac->probeSize(*t->_op));
+					spawn(*t);
+				}
+			}
+		}
+		else
+		{
+			ResultType res;
+			DAC_PROBE2(leaf_start,_depth,_dac->probeSize(*_op));
+			_dac->_seq_fn(*_op,res);
+			DAC_PROBE2(leaf_end,_depth,_dac->probeSize(*_op));
+			_dac->_reduce_fn(res,_dac->_accumulators->local());
+		}
+		if(_op!=_dac->_op)
+			delete _op;
+		if(_spawned)
+			_dac->taskCompleted();
+		return next;
+	}
+
+private:
+
+	DacTBB<OperandType,ResultType> *_dac;
+	const OperandType* _op;		//owned, except for the root
+	int _depth;
+	bool _spawned;		//counted by lazy splitting and elastic mode
 
 };
 
@@ -116,24 +426,269 @@ public:
 			  const std::function<void(std::vector<ResultType>&,ResultType&)>& combine_fn,
 			  const std::function<void(const OperandType&, ResultType&)>& seq_fn,
 			  const std::function<bool(const OperandType&)>& cond_fn, const OperandType& op, ResultType& res, int pardegree):
-				_divide_fn(divide_fn), _combine_fn(combine_fn), _seq_fn(seq_fn), _condition_fn(cond_fn), _op(&op), _res(&res), _pardegree(pardegree), _task_scheduler(pardegree)
+				_divide_fn(divide_fn), _combine_fn(combine_fn), _seq_fn(seq_fn), _condition_fn(cond_fn), _op(&op), _res(&res), _pardegree(pardegree), _max_depth(DAC_MAX_RECURSION_DEPTH), _batch_size(0), _batch_depth(0), _accumulators(nullptr), _spawn_policy(DAC_WORK_FIRST), _hybrid_depth(0), _work_span_analysis(false), _lazy_splitting(false), _queued(0), _task_scheduler(pardegree)
+	{
+
+
+	}
+
+	/**
+	 * @brief setMaxRecursionDepth nodes deeper than depth are solved by the task that reaches them
+	 * using an explicit stack, so native stack usage is bounded whatever is the shape of the tree. <=0: no limit
+	 */
+	void setMaxRecursionDepth(int depth)
+	{
+		_max_depth=depth;
+	}
+
+	/**
+	 * @brief setMemoryBudget limits the memory used by the temporaries of the nodes being solved in parallel.
+	 * mem_fn estimates the temporaries (subproblems and partial results) of a non-leaf node: when they would
+	 * exceed budget bytes the node is solved depth first, without spawning tasks
+	 */
+	void setMemoryBudget(size_t budget, const std::function<size_t(const OperandType&)>& mem_fn)
+	{
+		_mem_budget.setBudget(budget);
+		_mem_fn=mem_fn;
+	}
+
+	/**
+	 * @brief setBatchedLeaves subtrees rooted at depth>=batch_depth are solved by a single worker that collects
+	 * their leaves and solves them batch_size at a time with seq_batch_fn, instead of calling seq_fn on each of them
+	 */
+	void setBatchedLeaves(const std::function<void(const std::vector<const OperandType*>&,const std::vector<ResultType*>&)>& seq_batch_fn,
+						  int batch_size, int batch_depth)
+	{
+		_seq_batch_fn=seq_batch_fn;
+		_batch_size=batch_size;
+		_batch_depth=batch_depth;
+	}
+
+	/**
+	 * @brief setReduction the combine is an associative and commutative reduction: the results of the leaves
+	 * (and of the subtrees solved depth first) are folded by reduce_fn(partial,acc) into per-thread accumulators
+	 * starting from identity, and parents do not wait for their children. The memory budget is not used in this mode
+	 */
+	void setReduction(const std::function<void(const ResultType&,ResultType&)>& reduce_fn, const ResultType &identity)
+	{
+		_reduce_fn=reduce_fn;
+		_identity.reset(new ResultType(identity));
+	}
+
+	/**
+	 * @brief setSpawnPolicy how the children of a task are spawned (see dac_spawn_policy.hpp). Default: work first.
+	 * With DAC_HYBRID tasks at depth<hybrid_depth are help first, the others work first
+	 */
+	void setSpawnPolicy(DacSpawnPolicy policy, int hybrid_depth=0)
+	{
+		_spawn_policy=policy;
+		_hybrid_depth=hybrid_depth;
+	}
+
+	/**
+	 * @brief setPartialCombine the combine of the nodes solved in parallel is decomposed into steps, each one
+	 * fired as soon as the children it uses have completed (see dac_partial_combine.hpp)
+	 */
+	void setPartialCombine(const std::function<void(const OperandType&,ResultType&)>& init_fn,
+						   const std::vector<DacCombineStep<ResultType>>& steps,
+						   const std::function<void(ResultType&)>& release_fn=nullptr)
+	{
+		_partial_combine=DacPartialCombine<OperandType,ResultType>(init_fn,steps,release_fn);
+	}
+
+	/**
+	 * @brief setWorkSpanAnalysis times every node of the following runs to compute their work and span
+	 * (see dac_work_span.hpp). The analysis uses the standard execution: the reduction mode and the sequential
+	 * execution with one worker are disabled while it is active
+	 */
+	void setWorkSpanAnalysis(bool enable)
+	{
+		_work_span_analysis=enable;
+	}
+
+	/**
+	 * @brief getWorkSpan work and span measured by the last run with the analysis enabled
+	 */
+	const DacWorkSpan& getWorkSpan() const
 	{
+		return _work_span;
+	}
 
+	/**
+	 * @brief setElastic the number of active workers follows the load of the host, between min_workers
+	 * and max_workers (see dac_elastic.hpp). max_workers replaces the parallelism degree
+	 */
+	void setElastic(int min_workers, int max_workers)
+	{
+		_pardegree=max_workers;
+		_task_scheduler.terminate();
+		_task_scheduler.initialize(max_workers);
+		_elastic.reset(new DacElasticMonitor(min_workers,max_workers));
+	}
 
+	/**
+	 * @brief setLazySplitting children are spawned only when there is demand for them, i.e. when the tasks
+	 * spawned and not yet started by any worker are less than the workers. Otherwise they are solved by
+	 * the worker that divided their parent: the number of tasks follows the idle workers, not the input size
+	 */
+	void setLazySplitting(bool enable)
+	{
+		_lazy_splitting=enable;
+	}
+
+	/**
+	 * @brief setDependencies the children of a node depend on their siblings (see dac_dag.hpp): dep_fn(op,children,preds)
+	 * fills preds[i] with the indexes of the children that must be completed before the i-th one starts.
+	 * Children are always spawned as soon as they are ready (the spawn policy, lazy splitting and elastic mode
+	 * are not used for them). Not available in reduction mode
+	 */
+	void setDependencies(const std::function<void(const OperandType&,const std::vector<OperandType>&,std::vector<std::vector<int>>&)>& dep_fn)
+	{
+		_dependencies_fn=dep_fn;
+	}
+
+	/**
+	 * @brief setProbeSize size_fn(op) gives the size of an operand reported by the static probes (see dac_probes.hpp).
+	 * It is called only if the program is compiled with DAC_USDT, while a tracer is attached to the probe
+	 */
+	void setProbeSize(const std::function<long(const OperandType&)>& size_fn)
+	{
+		_probe_size_fn=size_fn;
 	}
 
 	void compute()
 	{
-		//create the first task
-		DacTask<OperandType,ResultType> *dac=new (tbb::task::allocate_root()) DacTask<OperandType,ResultType>(_divide_fn,_combine_fn,_seq_fn,_condition_fn,_op,_res);
-		tbb::task::spawn_root_and_wait(*dac);
+		DAC_PROBE1(compute_start,_pardegree);
+		if(_elastic)
+			_elastic->start();
 
+		if(_work_span_analysis)
+		{
+			DacTask<OperandType,ResultType> *dac=new (tbb::task::allocate_root()) DacTask<OperandType,ResultType>(this,_op,_res,0,&_work_span);
+			tbb::task::spawn_root_and_wait(*dac);
+		}
+		else if(_pardegree==1)
+		{
+			//a single worker: plain sequential recursion, without the parallel runtime
+			computeSequential();
+		}
+		else if(_reduce_fn)
+			computeReduction();
+		else
+		{
+			//create the first task
+			DacTask<OperandType,ResultType> *dac=new (tbb::task::allocate_root()) DacTask<OperandType,ResultType>(this,_op,_res,0);
+			tbb::task::spawn_root_and_wait(*dac);
+		}
 
+		if(_elastic)
+			_elastic->stop();
+		DAC_PROBE0(compute_end);
 	}
 
 
 private:
 
+	friend class DacTask<OperandType,ResultType>;
+	friend class DacReduceTask<OperandType,ResultType>;
+	friend class DacSpawnRangeTask<OperandType,ResultType>;
+
+	void computeSequential()
+	{
+		if(_seq_batch_fn)
+			solveDepthFirst(_op,_res);
+		else
+		{
+			DacSequential<OperandType,ResultType> dac(_divide_fn,_combine_fn,_seq_fn,_condition_fn,*_op,*_res);
+			dac.setMaxRecursionDepth(_max_depth);
+			dac.compute();
+		}
+	}
+
+	void computeReduction()
+	{
+		tbb::enumerable_thread_specific<ResultType> accumulators(*_identity);
+		_accumulators=&accumulators;
+		DacReduceTask<OperandType,ResultType> *dac=new (tbb::task::allocate_root()) DacReduceTask<OperandType,ResultType>(this,_op,0);
+		tbb::task::spawn_root_and_wait(*dac);
+
+		*_res=*_identity;
+		for(const ResultType &acc:accumulators)
+			_reduce_fn(acc,*_res);
+		_accumulators=nullptr;
+	}
+
+	//lazy splitting and elastic mode: a child is spawned only if some worker is waiting for work (and there
+	//is room for another task), otherwise it is solved by the calling worker
+	bool spawnChild()
+	{
+		if(_lazy_splitting && _queued.load(std::memory_order_relaxed)>=_pardegree)
+			return false;
+		if(_elastic && !_elastic->acquireTask())
+			return false;
+		if(_lazy_splitting)
+			_queued.fetch_add(1,std::memory_order_relaxed);
+		return true;
+	}
+
+	void taskStarted()
+	{
+		if(_lazy_splitting)
+			_queued.fetch_sub(1,std::memory_order_relaxed);
+	}
+
+	void taskCompleted()
+	{
+		if(_elastic)
+			_elastic->releaseTask();
+	}
+
+	//elastic mode: a task waiting for its children does not count among the running ones
+	void waitStarted()
+	{
+		if(_elastic)
+			_elastic->waitStarted();
+	}
+
+	void waitEnded()
+	{
+		if(_elastic)
+			_elastic->waitEnded();
+	}
+
+	long probeSize(const OperandType &op) const
+	{
+		return _probe_size_fn ? _probe_size_fn(op) : 0;
+	}
+
+	bool inlineLastChild(int depth) const
+	{
+		return dacInlineLastChild(_spawn_policy,_hybrid_depth,depth);
+	}
+
+	//reserve the memory of the temporaries of a non-leaf node: false if this would exceed the budget
+	bool reserveMemory(const OperandType *op, size_t &mem)
+	{
+		if(!_mem_fn || _condition_fn(*op))
+			return true;
+		mem=_mem_fn(*op);
+		return _mem_budget.reserve(mem);
+	}
+
+	//solve a subtree on the calling worker, without recursion
+	void solveDepthFirst(const OperandType *op, ResultType *ret)
+	{
+		if(_seq_batch_fn)
+		{
+			DacLeafBatcher<OperandType,ResultType> batcher(_divide_fn,_combine_fn,_seq_batch_fn,_condition_fn,_batch_size);
+			batcher.compute(op,ret);
+		}
+		else
+		{
+			DacExplicitStack<OperandType,ResultType> stack(_divide_fn,_combine_fn,_seq_fn,_condition_fn);
+			stack.compute(op,ret);
+		}
+	}
 
 	//function pointers
 	const std::function<void(const OperandType&,std::vector<OperandType>&)>& _divide_fn;
@@ -143,6 +698,25 @@ private:
 	const OperandType* _op;
 	ResultType* _res;
 	int _pardegree;
+	int _max_depth;
+	DacMemoryBudget _mem_budget;
+	std::function<size_t(const OperandType&)> _mem_fn;
+	std::function<void(const std::vector<const OperandType*>&,const std::vector<ResultType*>&)> _seq_batch_fn;
+	int _batch_size;
+	int _batch_depth;
+	std::function<void(const ResultType&,ResultType&)> _reduce_fn;
+	std::unique_ptr<ResultType> _identity;		//allocated only in reduction mode
+	tbb::enumerable_thread_specific<ResultType> *_accumulators;
+	DacSpawnPolicy _spawn_policy;
+	int _hybrid_depth;
+	bool _work_span_analysis;
+	DacWorkSpan _work_span;
+	DacPartialCombine<OperandType,ResultType> _partial_combine;
+	std::unique_ptr<DacElasticMonitor> _elastic;
+	bool _lazy_splitting;
+	std::atomic<int> _queued;		//tasks spawned and not yet started
+	std::function<void(const OperandType&,const std::vector<OperandType>&,std::vector<std::vector<int>>&)> _dependencies_fn;
+	std::function<long(const OperandType&)> _probe_size_fn;
 	tbb::task_scheduler_init _task_scheduler;		//needed to set par degree
 };
 
@@ -0,0 +1,152 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Work/span analysis of a DAC run.
+
+ During the analysis the backends time the divide, base case and combine of every node.
+ The work (T1) of a node is the sum of its own times and of the work of its children; its span (Tinf)
+ is its own time plus the longest span among its children. For the whole tree they give the
+ parallelism T1/Tinf, i.e. the maximum speedup achievable whatever the scheduler, and by Brent's bound
+ (Tp <= T1/p + Tinf) the speedup that a greedy scheduler guarantees with p workers.
+ A measured speedup well below the Brent one points to the scheduler (or to memory bandwidth),
+ a parallelism close to p points to the algorithm (e.g. a serial combine at the root).
+
+ Subtrees solved depth first (batched, too deep or over the memory budget) are measured as a whole.
+ Times are wall clock: the analysis is meaningful only if the workers are not more than the cores.
+*/
+
+#ifndef DAC_WORK_SPAN_HPP
+#define DAC_WORK_SPAN_HPP
+
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+
+struct DacWorkSpan{
+	double work=0;		//T1 (usecs)
+	double span=0;		//Tinf (usecs)
+
+	static DacWorkSpan leaf(double time)
+	{
+		DacWorkSpan ws;
+		ws.work=time;
+		ws.span=time;
+		return ws;
+	}
+
+	static DacWorkSpan node(double divide_time, const std::vector<DacWorkSpan> &children, double combine_time)
+	{
+		DacWorkSpan ws;
+		double children_span=0;
+		for(const DacWorkSpan &c:children)
+		{
+			ws.work+=c.work;
+			children_span=std::max(children_span,c.span);
+		}
+		ws.work+=divide_time+combine_time;
+		ws.span=divide_time+children_span+combine_time;
+		return ws;
+	}
+
+	/**
+	 * @brief node of children with dependencies (see dac_dag.hpp): the span goes through the longest chain
+	 * of dependent children
+	 */
+	static DacWorkSpan node(double divide_time, const std::vector<DacWorkSpan> &children,
+							const std::vector<std::vector<int>> &preds, double combine_time)
+	{
+		DacWorkSpan ws;
+		std::vector<double> finish(children.size());	//children are in topological order
+		double children_span=0;
+		for(size_t i=0;i<children.size();i++)
+		{
+			double start=0;
+			for(int p:preds[i])
+				start=std::max(start,finish[p]);
+			finish[i]=start+children[i].span;
+			children_span=std::max(children_span,finish[i]);
+			ws.work+=children[i].work;
+		}
+		ws.work+=divide_time+combine_time;
+		ws.span=divide_time+children_span+combine_time;
+		return ws;
+	}
+
+	double parallelism() const
+	{
+		return span>0 ? work/span : 1;
+	}
+
+	/**
+	 * @brief brentSpeedup speedup guaranteed by a greedy scheduler with pardegree workers
+	 */
+	double brentSpeedup(int pardegree) const
+	{
+		return work>0 ? work/(work/pardegree+span) : 1;
+	}
+
+	/**
+	 * @brief report prints work, span, parallelism and, for the powers of two up to max_pardegree,
+	 * the Brent (lower) and the work/span (upper) bounds of the speedup
+	 */
+	void report(std::ostream &out, int max_pardegree) const
+	{
+		out << std::fixed << std::setprecision(2);
+		out << "Work T1 (usecs): " << work << std::endl;
+		out << "Span Tinf (usecs): " << span << std::endl;
+		out << "Parallelism T1/Tinf: " << parallelism() << std::endl;
+		out << "Pardegree\tBrent speedup\tMax speedup" << std::endl;
+		for(int p=1;p<=max_pardegree;p=(p*2>max_pardegree && p<max_pardegree)?max_pardegree:p*2)
+			out << p << "\t\t" << brentSpeedup(p) << "\t\t" << std::min((double)p,parallelism()) << std::endl;
+	}
+};
+
+/*
+ * Measures consecutive intervals of the work of a node. When disabled it does not read the clock
+ */
+class DacWorkSpanTimer{
+
+public:
+
+	DacWorkSpanTimer(bool enabled): _enabled(enabled)
+	{
+		if(_enabled)
+			_last=std::chrono::steady_clock::now();
+	}
+
+	/**
+	 * @brief lap usecs elapsed since the previous lap (or the creation of the timer)
+	 */
+	double lap()
+	{
+		if(!_enabled)
+			return 0;
+		std::chrono::steady_clock::time_point now=std::chrono::steady_clock::now();
+		double elapsed=std::chrono::duration<double,std::micro>(now-_last).count();
+		_last=now;
+		return elapsed;
+	}
+
+private:
+	bool _enabled;
+	std::chrono::steady_clock::time_point _last;
+};
+
+#endif // DAC_WORK_SPAN_HPP
@@ -0,0 +1,115 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ The functions of the quicksort DAC (divide, combine, base case and its condition), shared by the
+ programs that sort arrays of integers with it: quicksort_dac, sort_stream_dac and multitenant_dac.
+ The programs set the cutoff (e.g. the one tuned for the host) and the workers of the parallel
+ partition at startup, through quicksortSettings().
+*/
+
+#ifndef QUICKSORT_FUNCTIONS_HPP
+#define QUICKSORT_FUNCTIONS_HPP
+
+#include <vector>
+#include <algorithm>
+#include "quicksort_partition.hpp"
+
+#define QUICKSORT_CUTOFF 2000
+
+// Operand (i.e. the Problem) and Results share the same format
+struct ops{
+	int *array=nullptr;			//array to sort
+	int left=0;					//left index
+	int right=0;				//right index
+};
+
+typedef struct ops Operand;
+typedef struct ops Result;
+
+struct QuicksortSettings{
+	int cutoff=QUICKSORT_CUTOFF;
+	int partition_workers=1;		//tasks of the partition of the whole array (OpenMP and TBB: the workers), 1: sequential
+	long num_sorted=1;				//length of the whole array
+};
+
+inline QuicksortSettings& quicksortSettings()
+{
+	static QuicksortSettings settings;
+	return settings;
+}
+
+/*
+ * The divide partitions the elements in three (see quicksort_partition.hpp): the ones equal to
+ * the pivot are already in place, the recursion occurs on the smaller and on the larger ones.
+ * Each range is partitioned by a share of the workers proportional to its length: the ranges
+ * of the upper levels, where there are fewer nodes than workers, by parallel tasks
+ */
+inline void divide(const Operand &op, std::vector<Operand> &ops)
+{
+	ops.push_back(Operand());
+	ops.push_back(Operand());
+
+	int *a=op.array;
+	int lt, gt;
+	const QuicksortSettings &s=quicksortSettings();
+	int segments=1;
+	if(s.partition_workers>1)
+		segments=s.partition_workers*(op.right-op.left+1L)/s.num_sorted;
+	quicksortParallelPartition(a,op.left,op.right,lt,gt,segments);
+
+	ops[0].array=a;
+	ops[0].left=op.left;
+	ops[0].right=lt-1;
+
+	ops[1].array=a;
+	ops[1].left=gt+1;
+	ops[1].right=op.right;
+}
+
+/*
+ * The Combine does nothing
+ */
+inline void mergeQS(std::vector<Result> &ress, Result &ret)
+{
+	ret.array=ress[0].array;
+	ret.left=ress[0].left;
+	ret.right=ress[1].right;
+}
+
+/*
+ * Base case: we resort on std::sort
+ */
+inline void seq(const Operand &op, Result &ret)
+{
+	std::sort(&(op.array[op.left]),&(op.array[op.right+1]));
+
+	//build result
+	ret.array=op.array;
+	ret.left=op.left;
+	ret.right=op.right;
+}
+
+/*
+ * Base case condition
+ */
+inline bool cond(const Operand &op)
+{
+	return (op.right-op.left<=quicksortSettings().cutoff);
+}
+
+#endif // QUICKSORT_FUNCTIONS_HPP
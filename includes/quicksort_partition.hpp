@@ -0,0 +1,222 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Partitioning step of the quicksort applications (pattern based and hand made ones), so that they
+ are compared on the same algorithm.
+
+ The pivot is the median of three elements for small ranges and Tukey's ninther (the median of the
+ medians of three samples of three) for large ones: it is close to the median also on partially
+ sorted inputs. The partition is three-way (Bentley-McIlroy): the keys equal to the pivot are moved
+ to the middle and are not sorted again, so inputs with many duplicate keys do not give unbalanced
+ splits and deep trees. On distinct keys it costs as the two-way Hoare partition.
+
+ The ranges of the upper levels (the root is the whole array) are partitioned by parallel tasks: the
+ range is cut into blocks, and each task claims a block from the left end and one from the right end,
+ swaps the keys larger than the pivot of the first with the smaller ones of the second, and claims a new
+ block on the side it has completed. When the blocks are all claimed, the ones left incomplete (at most
+ one per side and task) are swapped next to the middle, and this short middle is partitioned serially.
+ This partition is two-way: a second parallel pass moves the keys equal to the pivot next to it, when a
+ sample shows that they are frequent.
+*/
+
+#ifndef QUICKSORT_PARTITION_HPP
+#define QUICKSORT_PARTITION_HPP
+
+#include <algorithm>
+#include <vector>
+#include <atomic>
+#include "dac_parallel_for.hpp"
+
+#define QUICKSORT_NINTHER_SIZE 128		//smaller ranges use the median of three
+#define QUICKSORT_PARALLEL_SIZE (1<<20)	//smaller ranges are partitioned by a single thread
+#define QUICKSORT_BLOCK 4096			//keys claimed at a time by the tasks of a parallel partition
+#define QUICKSORT_SAMPLE 64				//keys compared with the pivot to look for duplicates
+
+//index of the median of a[i], a[j], a[k]
+template<typename T>
+int medianOfThree(const T *a, int i, int j, int k)
+{
+	if(a[i]<a[j])
+		return a[j]<a[k] ? j : (a[i]<a[k] ? k : i);
+	return a[k]<a[j] ? j : (a[k]<a[i] ? k : i);
+}
+
+/**
+ * @brief quicksortPivot index of the pivot of a[left..right]
+ */
+template<typename T>
+int quicksortPivot(const T *a, int left, int right)
+{
+	int n=right-left+1;
+	int mid=left+n/2;
+	if(n<QUICKSORT_NINTHER_SIZE)
+		return medianOfThree(a,left,mid,right);
+	int s=n/8;
+	int m1=medianOfThree(a,left,left+s,left+2*s);
+	int m2=medianOfThree(a,mid-s,mid,mid+s);
+	int m3=medianOfThree(a,right-2*s,right-s,right);
+	return medianOfThree(a,m1,m2,m3);
+}
+
+/**
+ * @brief quicksortPartition three-way partition of a[left..right] (left<right) around the pivot chosen by
+ * quicksortPivot. At the end a[left..lt-1] <= pivot, a[lt..gt] == pivot and a[gt+1..right] >= pivot: all the
+ * keys equal to the pivot are in the middle, but for the one where the two scans met (at most)
+ */
+template<typename T>
+void quicksortPartition(T *a, int left, int right, int &lt, int &gt)
+{
+	std::swap(a[quicksortPivot(a,left,right)],a[right]);
+	T pivot=a[right];
+
+	//keys equal to the pivot are parked at the two ends: a[left..p] and a[q..right-1]
+	int i=left-1, j=right;
+	int p=left-1, q=right;
+	while(true)
+	{
+		while(a[++i]<pivot);
+		while(pivot<a[--j])
+			if(j==left)
+				break;
+		if(i>=j)
+			break;
+		std::swap(a[i],a[j]);
+		if(a[i]==pivot)
+			std::swap(a[++p],a[i]);
+		if(a[j]==pivot)
+			std::swap(a[--q],a[j]);
+	}
+	std::swap(a[i],a[right]);
+
+	//move the parked keys next to the pivot
+	j=i-1;
+	i=i+1;
+	for(int k=left;k<=p;k++,j--)
+		std::swap(a[k],a[j]);
+	for(int k=right-1;k>=q;k--,i++)
+		std::swap(a[k],a[i]);
+	lt=j+1;
+	gt=i-1;
+}
+
+/**
+ * @brief quicksortBlockPartition parallel partition of a[0,n) with segments tasks: moves the keys for which
+ * pred holds before the others, and returns their number
+ */
+template<typename T, typename Predicate>
+int quicksortBlockPartition(T *a, int n, int segments, Predicate pred)
+{
+	const int B=QUICKSORT_BLOCK;
+	int nblocks=n/B;
+	std::atomic<int> claimed(0), nleft(0), nright(0);
+	//the blocks are numbered from the respective end: the left ones end with keys for which pred holds
+	auto block=[=](bool right, int b){ return right ? a+n-(b+1)*B : a+b*B; };
+	auto claim=[&](std::atomic<int> &side){
+		return claimed.fetch_add(1)<nblocks ? side.fetch_add(1) : -1;
+	};
+
+	//blocks that each task left incomplete (-1: none)
+	std::vector<int> open_left(segments,-1), open_right(segments,-1);
+	dacParallelFor(segments,[&](int s){
+		int l=-1, r=-1;
+		int i=0, j=0;		//first keys of the blocks not yet checked
+		while(true)
+		{
+			if(l<0 && (l=claim(nleft))<0)
+				break;
+			if(r<0 && (r=claim(nright))<0)
+				break;
+			T *x=block(false,l), *y=block(true,r);
+			while(true)
+			{
+				while(i<B && pred(x[i]))
+					i++;
+				while(j<B && !pred(y[j]))
+					j++;
+				if(i==B || j==B)
+					break;
+				std::swap(x[i++],y[j++]);
+			}
+			if(i==B)
+			{
+				l=-1;
+				i=0;
+			}
+			if(j==B)
+			{
+				r=-1;
+				j=0;
+			}
+		}
+		open_left[s]=l;
+		open_right[s]=r;
+	});
+
+	//the incomplete blocks of a side are swapped with the complete ones closest to the middle
+	auto gather=[&](bool right, int count, std::vector<int> &open){
+		open.erase(std::remove(open.begin(),open.end(),-1),open.end());
+		std::sort(open.begin(),open.end());
+		int complete=count-open.size();
+		int t=complete;
+		for(int o:open)
+		{
+			if(o>=complete)
+				break;
+			while(std::binary_search(open.begin(),open.end(),t))
+				t++;
+			std::swap_ranges(block(right,o),block(right,o)+B,block(right,t++));
+		}
+		return complete;
+	};
+	int complete_left=gather(false,nleft,open_left);
+	int complete_right=gather(true,nright,open_right);
+
+	//the middle: the incomplete blocks and the keys that do not fill a block
+	return std::partition(a+complete_left*B,a+n-complete_right*B,pred)-a;
+}
+
+/**
+ * @brief quicksortParallelPartition as quicksortPartition, but ranges of at least QUICKSORT_PARALLEL_SIZE keys
+ * are partitioned by segments parallel tasks (see dacParallelFor). All the keys equal to the pivot are in
+ * a[lt..gt] only if a sample shows that they are frequent
+ */
+template<typename T>
+void quicksortParallelPartition(T *a, int left, int right, int &lt, int &gt, int segments)
+{
+	int n=right-left;		//keys but the pivot
+	segments=std::min(segments,n/(QUICKSORT_BLOCK*4));
+	if(n<QUICKSORT_PARALLEL_SIZE || segments<=1)
+	{
+		quicksortPartition(a,left,right,lt,gt);
+		return;
+	}
+	std::swap(a[quicksortPivot(a,left,right)],a[right]);
+	T pivot=a[right];
+	int duplicates=0;
+	for(int k=0;k<QUICKSORT_SAMPLE;k++)
+		duplicates+=(a[left+(long)k*n/QUICKSORT_SAMPLE]==pivot);
+
+	//a[left..lt-1] < pivot, and the pivot goes to a[lt]
+	lt=left+quicksortBlockPartition(a+left,n,segments,[&pivot](const T &x){ return x<pivot; });
+	std::swap(a[lt],a[right]);
+	gt=lt;
+	if(duplicates>0)
+		gt+=quicksortBlockPartition(a+lt+1,right-lt,segments,[&pivot](const T &x){ return !(pivot<x); });
+}
+
+#endif // QUICKSORT_PARTITION_HPP
@@ -89,6 +89,8 @@ double *generateCompactRowMatrix(int n);
 double *generateCompactColumnMatrix(int n);
 void printCompactMatrix(double *a, int n, int row_stride);
 double *compactMatmul(double *a, int rs_a, double *b, int rs_b, int n);
+//the result is stored in c (row stride n)
+void compactMatmul(double *a, int rs_a, double *b, int rs_b, double *c, int n);
 
 //C=A+B
 void addMatrix(double **a, double **b,double **c,int n);
@@ -0,0 +1,170 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Offline autotuner: for each application and backend compiled in the current directory, it sweeps
+ cutoff values, parallelism degrees and input sizes and stores the best configuration for each
+ size bucket in the profile of the host (see dac_profile.hpp).
+
+ The applications are run as they are: the cutoff is passed with the DAC_CUTOFF environment variable
+ and the time is taken from their output.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include "../includes/dac_profile.hpp"
+using namespace std;
+
+struct TunedApp{
+	const char *name;
+	vector<long> sizes;
+	vector<int> cutoffs;
+};
+
+//search space of the applications
+static const vector<TunedApp> apps={
+	{"mergesort_dac",			{1<<20, 1<<22, 1<<24},	{250, 500, 1000, 2000, 4000, 8000, 16000}},
+	{"quicksort_dac",			{1<<20, 1<<22, 1<<24},	{250, 500, 1000, 2000, 4000, 8000, 16000}},
+	{"stable_mergesort_dac",	{1<<20, 1<<22, 1<<24},	{125, 250, 500, 1000, 2000, 4000}},
+	{"strassen_dac",			{512, 1024, 2048},		{32, 64, 128, 256}},
+	{"editdistance_dac",		{2048, 4096, 8192},		{32, 64, 128, 256}}
+};
+
+static const char *backends[]={"openmp", "tbb", "ff", "coro", "seq"};
+
+
+/*
+ * Next number of workers of the sweep: the powers of two, and max_workers as the last one
+ */
+int nextWorkers(int nwork, int max_workers)
+{
+	int next=nwork*2;
+	if(nwork<max_workers && next>max_workers)
+		next=max_workers;
+	return next;
+}
+
+/*
+ * Runs an application and returns its completion time (usecs), -1 in case of error
+ */
+long run(const string &exe, long size, int nwork, int cutoff)
+{
+	char cmd[1024];
+	snprintf(cmd,sizeof(cmd),"DAC_CUTOFF=%d ./%s %ld %d 2>&1",cutoff,exe.c_str(),size,nwork);
+	FILE *out=popen(cmd,"r");
+	if(out==nullptr)
+		return -1;
+
+	long time=-1;
+	char line[1024];
+	while(fgets(line,sizeof(line),out)!=nullptr)
+	{
+		//"Time (usecs): <t>" or "Time strassen (msecs): <t>"
+		char *value=strchr(line,':');
+		if(strncmp(line,"Time",4)!=0 || value==nullptr)
+			continue;
+		double t=atof(value+1);
+		time=(long)(strstr(line,"msecs")!=nullptr ? t*1000 : t);
+	}
+	if(pclose(out)!=0)
+		return -1;
+	return time;
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc<2)
+	{
+		cerr << "Usage: "<<argv[0]<< " <max_workers> [<repetitions>] [<profile_file>]"<<endl;
+		cerr << "Tunes the applications compiled in the current directory (<app>_<backend>)"<<endl;
+		exit(-1);
+	}
+	int max_workers=atoi(argv[1]);
+	int repetitions=(argc>2)?atoi(argv[2]):3;
+	string path=(argc>3)?string(argv[3]):DacProfile::defaultPath();
+
+	//the buckets measured by this run replace the previous results, the others are kept
+	DacProfile profile(path);
+	std::set<std::string> measured;
+
+	for(const TunedApp &app:apps)
+	{
+		for(const char *backend:backends)
+		{
+			string exe=string(app.name)+"_"+backend;
+			if(access(exe.c_str(),X_OK)!=0)
+				continue;
+
+			for(long size:app.sizes)
+			{
+				DacProfileEntry best;
+				best.time_usecs=-1;
+				for(int nwork=1;nwork<=max_workers;nwork=nextWorkers(nwork,max_workers))
+				{
+					for(int cutoff:app.cutoffs)
+					{
+						//the fastest of the repetitions
+						long time=-1;
+						for(int r=0;r<repetitions;r++)
+						{
+							long t=run(exe,size,nwork,cutoff);
+							if(t>=0 && (time<0 || t<time))
+								time=t;
+						}
+						if(time<0)
+						{
+							cerr << "Error running "<<exe<<" (size: "<<size<<", workers: "<<nwork<<", cutoff: "<<cutoff<<")"<<endl;
+							continue;
+						}
+						if(best.time_usecs<0 || time<best.time_usecs)
+						{
+							best.app=app.name;
+							best.backend=backend;
+							best.size_bucket=DacProfile::sizeBucket(size);
+							best.cutoff=cutoff;
+							best.pardegree=nwork;
+							best.time_usecs=time;
+						}
+					}
+				}
+				if(best.time_usecs<0)
+					continue;
+				cout << exe<<" size "<<size<<": cutoff "<<best.cutoff<<", workers "<<best.pardegree<<" ("<<best.time_usecs<<" usecs)"<<endl;
+				//sizes in the same bucket: the fastest of this run
+				std::string key=exe+" "+std::to_string(best.size_bucket);
+				if(measured.insert(key).second)
+					profile.replace(best);
+				else
+					profile.update(best);
+				//save after each size, so that a long tuning can be interrupted
+				if(!profile.save(path))
+				{
+					cerr << "Error: can not write the profile "<<path<<endl;
+					exit(-1);
+				}
+			}
+		}
+	}
+	cout << "Profile saved in "<<path<<endl;
+	return 0;
+}
@@ -0,0 +1,218 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Edit distance: cache-oblivious DAC computation of the (Levenshtein) distance between two random strings.
+
+ The dynamic programming table is recursively split into quadrants: the top-right and bottom-left ones
+ depend on the top-left one, the bottom-right one on both of them. The quadrants are children of the
+ same node with dependencies among them (see dac_dag.hpp): the two anti-diagonal ones run in parallel.
+ If compiled with -DCHECK perform the correctness check against the row by row algorithm
+*/
+
+#include <iostream>
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include "../includes/utils.h"
+#include "../includes/dac_profile.hpp"
+#if USE_FF || USE_CORO
+#error "the children of a node depend on each other: dependencies are supported by the OpenMP, TBB and sequential backends"
+#endif
+#if USE_OPENMP
+#include "../includes/dac_openmp.hpp"
+#endif
+#if USE_TBB
+#include "../includes/dac_tbb.hpp"
+#endif
+#if USE_SEQUENTIAL
+#include "../includes/dac_sequential.hpp"
+#endif
+
+#define CUTOFF 128	//blocks CUTOFFxCUTOFF are filled row by row
+int cutoff=CUTOFF;	//replaced at startup by the one tuned for this host (if any)
+
+using namespace std;
+
+//the two strings and the dynamic programming table: dist[i*width+j] is the distance between
+//the first i characters of a and the first j characters of b
+const char *a;
+const char *b;
+int *dist;
+long width;
+
+/*
+ * Problem: a block of the table (rows and columns start from 1, row and column 0 are the base case)
+ * Result: the value of its bottom-right cell
+ */
+struct Block{
+	int row;
+	int col;
+	int rows;
+	int cols;
+};
+
+/*
+ * Divide Function: the block is split into (up to) four quadrants, in topological order
+ */
+void divide(const Block &op, std::vector<Block> &subops)
+{
+	int top=(op.rows>1)?op.rows/2:op.rows;
+	int left=(op.cols>1)?op.cols/2:op.cols;
+	int rows[2]={top,op.rows-top};
+	int cols[2]={left,op.cols-left};
+	for(int i=0;i<2;i++)
+	{
+		for(int j=0;j<2;j++)
+		{
+			if(rows[i]>0 && cols[j]>0)
+				subops.push_back({op.row+i*top,op.col+j*left,rows[i],cols[j]});
+		}
+	}
+}
+
+/*
+ * Dependencies: a quadrant needs the one above it and the one on its left
+ */
+void dependencies(const Block &op, const std::vector<Block> &subops, std::vector<std::vector<int>> &preds)
+{
+	for(size_t k=0;k<subops.size();k++)
+	{
+		for(size_t l=0;l<k;l++)
+		{
+			bool above=(subops[l].col==subops[k].col && subops[l].row+subops[l].rows==subops[k].row);
+			bool on_left=(subops[l].row==subops[k].row && subops[l].col+subops[l].cols==subops[k].col);
+			if(above || on_left)
+				preds[k].push_back(l);
+		}
+	}
+}
+
+/*
+ * Base Case: the block is filled row by row
+ */
+void seq(const Block &op, int &res)
+{
+	for(int i=op.row;i<op.row+op.rows;i++)
+	{
+		int *cur=dist+i*width;
+		const int *prev=cur-width;
+		for(int j=op.col;j<op.col+op.cols;j++)
+			cur[j]=min(min(prev[j],cur[j-1])+1,prev[j-1]+(a[i-1]!=b[j-1]));
+	}
+	res=dist[(op.row+op.rows-1)*width+op.col+op.cols-1];
+}
+
+/*
+ * Combine function: the table has been filled in place, the bottom-right quadrant is the last one
+ */
+void combine(vector<int> &ress, int &ret)
+{
+	ret=ress.back();
+}
+
+/*
+ * Condition for base case
+ */
+bool cond(const Block &op)
+{
+	return (op.rows<=cutoff && op.cols<=cutoff);
+}
+
+char *generateRandomString(int length, unsigned int seed)
+{
+	static const char alphabet[]="ACGT";
+	char *s=new char[length];
+	srand(seed);
+	for(int i=0;i<length;i++)
+		s[i]=alphabet[rand()%4];
+	return s;
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc<3)
+	{
+		cerr << "Usage: "<<argv[0]<< " <string_length> <nwork>"<<endl;
+		exit(-1);
+	}
+	int length=atoi(argv[1]);
+	int nwork=atoi(argv[2]);
+	cutoff=dacTunedCutoff("editdistance_dac",length,CUTOFF,nwork);
+
+	char *sa=generateRandomString(length,1);
+	char *sb=generateRandomString(length,2);
+	a=sa;
+	b=sb;
+	width=length+1;
+	dist=new int[width*width];
+	for(long i=0;i<width;i++)
+	{
+		dist[i*width]=i;
+		dist[i]=i;
+	}
+
+	Block op={1,1,length,length};
+	int res;
+
+	//functions
+	std::function<void(const Block&, std::vector<Block> &)> div(divide);
+	std::function <void(const Block &,int &)> sq(seq);
+	std::function <void(vector<int>&,int &)> comb(combine);
+	std::function<bool(const Block &)> cf(cond);
+#if USE_OPENMP
+	DacOpenmp<Block, int> dac(div,comb,sq,cf,op,res,nwork);
+#endif
+#if USE_TBB
+	DacTBB<Block, int> dac(div,comb,sq,cf,op,res,nwork);
+#endif
+#if USE_SEQUENTIAL
+	DacSequential<Block, int> dac(div,comb,sq,cf,op,res);
+#endif
+#if USE_OPENMP || USE_TBB
+	dac.setDependencies(dependencies);
+#endif
+
+	long start_t=current_time_usecs();
+	dac.compute();
+	long end_t=current_time_usecs();
+
+#if CHECK
+	printf("Check Solution....\n");
+	vector<int> prev(width), cur(width);
+	for(long j=0;j<width;j++)
+		prev[j]=j;
+	for(int i=1;i<=length;i++)
+	{
+		cur[0]=i;
+		for(int j=1;j<=length;j++)
+			cur[j]=min(min(prev[j],cur[j-1])+1,prev[j-1]+(sa[i-1]!=sb[j-1]));
+		swap(prev,cur);
+	}
+	if(prev[length]==res)
+		printf("Check result: OK\n");
+	else
+		fprintf(stderr,"Check result: distances are not equal!!\n");
+#endif
+	printf("Edit distance: %d\n",res);
+	printf("Time (usecs): %ld\n",end_t-start_t);
+
+	delete[] sa;
+	delete[] sb;
+	delete[] dist;
+}
@@ -35,6 +35,12 @@ using namespace ff;
 #if USE_TBB
 #include "../includes/dac_tbb.hpp"
 #endif
+#if USE_CORO
+#include "../includes/dac_coro.hpp"
+#endif
+#if USE_SEQUENTIAL
+#include "../includes/dac_sequential.hpp"
+#endif
 
 
 using namespace std;
@@ -60,6 +66,15 @@ void seq(const unsigned int &op, unsigned int &res)
 	res=1;
 }
 
+/*
+ * Batched base case: all the leaves collected by a worker are solved at once
+ */
+void seqBatch(const vector<const unsigned int*> &ops, const vector<unsigned int*> &ress)
+{
+	for(size_t i=0;i<ress.size();i++)
+		*ress[i]=1;
+}
+
 /*
  * Combine function
  */
@@ -68,6 +83,14 @@ void combine(vector<unsigned int>& res, unsigned int &ret)
 	ret=res[0]+res[1];
 }
 
+/*
+ * Reduction: the result is the sum of the results of the leaves
+ */
+void reduce(const unsigned int &partial, unsigned int &acc)
+{
+	acc+=partial;
+}
+
 /*
  * Condition for base case
  */
@@ -83,7 +106,7 @@ int main(int argc, char *argv[])
 
 	if(argc<3)
 	{
-		fprintf(stderr,"Usage: %s <N> <pardegree>\n",argv[0]);
+		fprintf(stderr,"Usage: %s <N> <pardegree> [<leaf_batch_size>] [<reduce (0|1)>] [<lazy_splitting (0|1)>]\n",argv[0]);
 		exit(-1);
 	}
 	unsigned int start=atoi(argv[1]);
@@ -91,6 +114,12 @@ int main(int argc, char *argv[])
 
 	unsigned int res;
 
+	//the backends keep references to the functions: they must outlive the pattern
+	std::function<void(const unsigned int&,std::vector<unsigned int>&)> div(divide);
+	std::function <void(const unsigned int &,unsigned int &)> sq(seq);
+	std::function <void(vector<unsigned int>&,unsigned int &)> comb(combine);
+	std::function<bool(const unsigned int &)> cf(cond);
+
 	//lambda version just for testing it
 #if USE_FF
 	ff_DC<unsigned int, unsigned int> dac(
@@ -113,10 +142,40 @@ int main(int argc, char *argv[])
 				);
 #endif
 #if USE_OPENMP
-	DacOpenmp<unsigned int, unsigned int> dac(divide,combine,seq,cond,start,res,nwork);
+	DacOpenmp<unsigned int, unsigned int> dac(div,comb,sq,cf,start,res,nwork);
 #endif
 #if USE_TBB
-	DacTBB<unsigned int, unsigned int> dac(divide,combine,seq,cond,start,res,nwork);
+	DacTBB<unsigned int, unsigned int> dac(div,comb,sq,cf,start,res,nwork);
+#endif
+#if USE_CORO
+	DacCoro<unsigned int, unsigned int> dac(div,comb,sq,cf,start,res,nwork);
+#endif
+#if USE_SEQUENTIAL
+	(void)nwork;	//a single worker
+	DacSequential<unsigned int, unsigned int> dac(div,comb,sq,cf,start,res);
+#endif
+#if USE_OPENMP || USE_TBB
+	int batch_size=(argc>3)?atoi(argv[3]):0;	//0: leaves are solved one at a time
+	if(batch_size>0)
+	{
+		//below the first levels (enough to feed the workers) leaves are batched
+		int batch_depth=0;
+		while((1<<batch_depth)<16*nwork)
+			batch_depth++;
+		dac.setBatchedLeaves(seqBatch,batch_size,batch_depth);
+	}
+	bool reduction=(argc>4)?atoi(argv[4])!=0:false;
+	if(reduction)
+		dac.setReduction(reduce,0);
+	bool lazy=(argc>5)?atoi(argv[5])!=0:false;
+	dac.setLazySplitting(lazy);
+#elif USE_CORO
+	//not available with coroutines (see dac_coro.hpp)
+	if((argc>3 && atoi(argv[3])>0) || (argc>4 && atoi(argv[4])!=0) || (argc>5 && atoi(argv[5])!=0))
+	{
+		fprintf(stderr,"Batched leaves, reduction and lazy splitting are not supported by the coroutine backend\n");
+		exit(-1);
+	}
 #endif
 
     long start_t=current_time_usecs();
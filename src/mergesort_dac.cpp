@@ -21,6 +21,7 @@
 
  Mergesort: sort an array of N integer in parallel using the DAC pattern
   and C++11 semantics (iterator)
+ If compiled with -DWORKSPAN (OpenMP and TBB) it reports the work/span analysis of the run
 
 
 */
@@ -30,6 +31,9 @@
 #include <algorithm>
 #include <cstring>
 #include "../includes/utils.h"
+#include "../includes/dac_profile.hpp"
+#include "../includes/dac_parallel_merge.hpp"
+#include "../includes/dac_simd_merge.hpp"
 #if USE_FF
 #include <ff/dc.hpp>
 using namespace ff;
@@ -40,14 +44,28 @@ using namespace ff;
 #if USE_TBB
 #include "../includes/dac_tbb.hpp"
 #endif
+#if USE_CORO
+#include "../includes/dac_coro.hpp"
+#endif
+#if USE_SEQUENTIAL
+#include "../includes/dac_sequential.hpp"
+#endif
 using namespace std;
 #define CUTOFF 2000
+int cutoff=CUTOFF;	//replaced at startup by the one tuned for this host (if any)
+#define MERGE_GRAIN (1<<16)	//minimum length of a segment of a parallel merge
+int merge_workers=1;	//segments of the merge at the root (OpenMP and TBB: the workers)
+long num_sorted;		//length of the array
 
 
-// Operand (i.e. the Problem) and Results share the same format
+// Operand (i.e. the Problem) and Results share the same format.
+// Levels alternate between the array and an auxiliary buffer of the same size (allocated once):
+// inplace tells whether the sorted range must be in the array or in the buffer (from aux)
 struct ops{
 	vector<int>::iterator left;
 	vector<int>::iterator right;
+	vector<int>::iterator aux;		//position of left in the buffer
+	bool inplace;
 };
 
 typedef struct ops Operand;
@@ -64,59 +82,75 @@ void divide(const Operand &op,std::vector<Operand> &subops)
 	Operand a;
 	a.left=op.left;
 	a.right=mid;
+	a.aux=op.aux;
+	a.inplace=!op.inplace;	//the merge moves the halves into the other buffer
 	subops.push_back(a);
 
 	Operand b;
 	b.left=mid;
 	b.right=op.right;
+	b.aux=op.aux+(mid-op.left);
+	b.inplace=!op.inplace;
 	subops.push_back(b);
 }
 
+//where the sorted range of a result is
+vector<int>::iterator sorted(const Result &r)
+{
+	return r.inplace ? r.left : r.aux;
+}
+
 
 /*
- * For the base case we resort to std::sort
+ * For the base case we resort to std::sort (then the range is moved to the buffer, if needed)
  */
 void seq(const Operand &op, Result &ret)
 {
 	ret=op;
 	std::sort(ret.left,ret.right);
+	if(!ret.inplace)
+		std::copy(ret.left,ret.right,ret.aux);
 }
 
 
 /*
- * The Merge (Combine) function start from two ordered sub array and construct the original one
- * It uses additional memory
+ * Serial merge of [i,mid) and [j,end) into out, with vector instructions if available
  */
-void mergeMS(vector<Result>&ress, Result &ret)
+void serialMerge(vector<int>::iterator i, vector<int>::iterator mid, vector<int>::iterator j, vector<int>::iterator end, vector<int>::iterator out)
 {
-	//compute what is needed: array pointer, mid, ...
-	vector<int>::iterator i=ress[0].left;
-	vector<int>::iterator mid=ress[0].right;
-	vector<int>::iterator j=mid;
-	int size=ress[1].right-ress[0].left;
-	vector<int> tmp(size);
-
-	//merge in order
-	for(int k=0;k<size;k++)
-	{
-		if(i<mid && (j>=ress[1].right || *i<=*j))
-		{
-			tmp[k]=*i;
-			i++;
-		}
-		else
-		{
-			tmp[k]=*j;
-			j++;
-		}
-	}
-
-	//copy back
+	long n=mid-i, m=end-j;
+	if(n+m==0)
+		return;
+	//an empty range may start at the end of the array: it is not dereferenced
+	const int *x=(n>0 ? &*i : nullptr);
+	const int *y=(m>0 ? &*j : nullptr);
+	dacMerge(x,x+n,y,y+m,&*out);
+}
 
-	std::copy(tmp.begin(),tmp.end(),ress[0].left);
+/*
+ * The Merge (Combine) function start from two ordered sub array and construct the original one.
+ * The halves are in one buffer (array or auxiliary one), they are merged into the other one.
+ * The upper levels, where there are fewer merges than workers, are merged in parallel: a merge
+ * gets the share of the workers proportional to its length
+ */
+void mergeMS(vector<Result>&ress, Result &ret)
+{
 	//build the result
 	ret.left=ress[0].left;
 	ret.right=ress[1].right;
+	ret.aux=ress[0].aux;
+	ret.inplace=!ress[0].inplace;
+
+	//compute what is needed: array pointer, mid, ...
+	vector<int>::iterator i=sorted(ress[0]);
+	vector<int>::iterator mid=i+(ress[0].right-ress[0].left);
+	vector<int>::iterator j=mid;
+	vector<int>::iterator end=j+(ress[1].right-ress[1].left);
+	vector<int>::iterator out=sorted(ret);
+	long size=ret.right-ret.left;
+	int segments=std::min(merge_workers*size/num_sorted,size/MERGE_GRAIN);
+
+	dacParallelMerge(i,mid,j,end,out,std::less<int>(),segments,serialMerge);
 }
 
 
@@ -125,7 +159,7 @@ void mergeMS(vector<Result>&ress, Result &ret)
  */
 bool cond(const Operand &op)
 {
-	return (op.right-op.left<=CUTOFF);
+	return (op.right-op.left<=cutoff);
 }
 
 //simple check
@@ -141,7 +175,8 @@ int main(int argc, char *argv[])
 {
 	if(argc<2)
 	{
-		cerr << "Usage: "<<argv[0]<< " <num_elements> <num_workers>"<<endl;
+		cerr << "Usage: "<<argv[0]<< " <num_elements> <num_workers> [<min_workers>]"<<endl;
+		cerr << "With min_workers the active workers follow the load of the host, between min_workers and num_workers"<<endl;
 		exit(-1);
 	}
 	std::function<void(const Operand&,vector<Operand>&)> div(divide);
@@ -151,16 +186,25 @@ int main(int argc, char *argv[])
 
 	int num_elem=atoi(argv[1]);
 	int nwork=atoi(argv[2]);
+	cutoff=dacTunedCutoff("mergesort_dac",num_elem,CUTOFF,nwork);
+	num_sorted=num_elem;
+#if USE_OPENMP || USE_TBB
+	merge_workers=nwork;
+#endif
 	//generate a random array
 	auto *numbers=generateRandomArray<int>(num_elem);
 	//fill the vector
 	vector<int> v(numbers, numbers+num_elem ); // use some utility to avoid hardcoding the size here
 
+	vector<int> buffer(num_elem);
+
 	//build the operand
 	Operand op;
 
 	op.left=v.begin();
 	op.right=v.end();
+	op.aux=buffer.begin();
+	op.inplace=true;
 
 	Result res;
 #if USE_FF
@@ -172,6 +216,33 @@ int main(int argc, char *argv[])
 #if USE_TBB
 	DacTBB<Operand, Result> dac(div,mergef,sq,cf,op,res,nwork);
 #endif
+#if USE_CORO
+	DacCoro<Operand, Result> dac(div,mergef,sq,cf,op,res,nwork);
+#endif
+#if USE_SEQUENTIAL
+	DacSequential<Operand, Result> dac(div,mergef,sq,cf,op,res);
+#endif
+#if USE_OPENMP || USE_TBB || USE_CORO
+	//binary tree: the parent sorts one half itself
+	dac.setSpawnPolicy(DAC_WORK_FIRST);
+	//size reported by the static probes (-DDAC_USDT)
+	dac.setProbeSize([](const Operand &op){ return (long)(op.right-op.left); });
+#endif
+#if USE_OPENMP || USE_TBB
+#if WORKSPAN
+	dac.setWorkSpanAnalysis(true);
+#endif
+	int min_work=(argc>3)?atoi(argv[3]):0;	//0: fixed number of workers
+	if(min_work>0)
+		dac.setElastic(min_work,nwork);
+#elif USE_CORO
+	//not available with coroutines (see dac_coro.hpp)
+	if(argc>3 && atoi(argv[3])>0)
+	{
+		cerr << "The elastic mode is not supported by the coroutine backend" << endl;
+		exit(-1);
+	}
+#endif
 
 	long start_t=current_time_usecs();
 
@@ -191,6 +262,9 @@ int main(int argc, char *argv[])
 		exit(-1);
 	}
 	printf("Time (usecs): %ld\n",end_t-start_t);
+#if WORKSPAN && (USE_OPENMP || USE_TBB)
+	dac.getWorkSpan().report(cout,64);
+#endif
 
 	return 0;
 }
@@ -0,0 +1,161 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Multi-tenant: a large, low weight, matrix product and a sequence of small quicksort requests
+ share the same workers (dac_scheduler.hpp). The requests use the functions of quicksort_dac (quicksort_functions.hpp). The requests are submitted by another thread, one at a time,
+ with a higher weight: their latency depends on their share, not on the size of the product.
+*/
+
+#include <iostream>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include "../includes/utils.h"
+#include "../includes/dac_scheduler.hpp"
+#include "../includes/quicksort_functions.hpp"
+using namespace std;
+#define MATMUL_CUTOFF 16	//rows of C computed by a leaf
+
+/*
+ * Background job: C=AB, split by blocks of rows of C. The result is the number of rows computed
+ */
+double *a, *b, *c;
+int matrix_size;
+
+struct Rows{
+	int first;
+	int count;
+};
+
+void divideRows(const Rows &op, std::vector<Rows> &ops)
+{
+	int half=op.count/2;
+	ops.push_back({op.first,half});
+	ops.push_back({op.first+half,op.count-half});
+}
+
+void combineRows(vector<int> &ress, int &ret)
+{
+	ret=ress[0]+ress[1];
+}
+
+void seqRows(const Rows &op, int &ret)
+{
+	for(int i=op.first;i<op.first+op.count;i++)
+	{
+		double *ci=c+(long)i*matrix_size;
+		std::fill(ci,ci+matrix_size,0.0);
+		for(int k=0;k<matrix_size;k++)
+		{
+			double aik=a[(long)i*matrix_size+k];
+			const double *bk=b+(long)k*matrix_size;
+			for(int j=0;j<matrix_size;j++)
+				ci[j]+=aik*bk[j];
+		}
+	}
+	ret=op.count;
+}
+
+bool condRows(const Rows &op)
+{
+	return op.count<=MATMUL_CUTOFF;
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc<5)
+	{
+		cerr << "Usage: "<<argv[0]<< " <num_workers> <matrix_size> <num_requests> <request_size> [<request_weight>]"<<endl;
+		cerr << "The product has weight 1, the quicksort requests request_weight (default 10)"<<endl;
+		exit(-1);
+	}
+	int nwork=atoi(argv[1]);
+	matrix_size=atoi(argv[2]);
+	int num_requests=atoi(argv[3]);
+	int request_size=atoi(argv[4]);
+	double request_weight=(argc>5)?atof(argv[5]):10;
+
+	std::function<void(const Operand &,vector<Operand> &)> div(divide);
+	std::function <void(const Operand &,Result &)> sq(seq);
+	std::function <void(vector<Result >&,Result &)> mergef(mergeQS);
+	std::function<bool(const Operand &)> cf(cond);
+	std::function<void(const Rows &,vector<Rows> &)> div_rows(divideRows);
+	std::function <void(const Rows &,int &)> sq_rows(seqRows);
+	std::function <void(vector<int>&,int &)> comb_rows(combineRows);
+	std::function<bool(const Rows &)> cf_rows(condRows);
+
+	a=generateCompactRandomMatrix(matrix_size);
+	b=generateCompactRandomMatrix(matrix_size);
+	c=allocateCompactMatrix(matrix_size);
+	vector<int*> requests(num_requests);
+	for(int i=0;i<num_requests;i++)
+		requests[i]=generateRandomArray<int>(request_size,i);
+
+	DacScheduler scheduler(nwork);
+
+	//the product is submitted first, then the requests arrive one after the other
+	long start_t=current_time_usecs();
+	Rows rows={0,matrix_size};
+	int rows_done;
+	std::shared_ptr<DacJob> product=scheduler.submit(div_rows,comb_rows,sq_rows,cf_rows,rows,rows_done,1.0);
+
+	long total_latency=0, max_latency=0;
+	std::thread client([&]{
+		for(int i=0;i<num_requests;i++)
+		{
+			Operand op;
+			op.array=requests[i];
+			op.left=0;
+			op.right=request_size-1;
+			Result res;
+			long start_r=current_time_usecs();
+			scheduler.submit(div,mergef,sq,cf,op,res,request_weight)->wait();
+			long latency=current_time_usecs()-start_r;
+			total_latency+=latency;
+			max_latency=max(max_latency,latency);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+	client.join();
+	product->wait();
+	long end_t=current_time_usecs();
+
+	for(int i=0;i<num_requests;i++)
+	{
+		if(!isArraySorted(requests[i],request_size))
+		{
+			fprintf(stderr,"Error: request is not sorted!!\n");
+			exit(-1);
+		}
+		delete[] requests[i];
+	}
+	if(rows_done!=matrix_size)
+	{
+		fprintf(stderr,"Error: %d rows computed out of %d\n",rows_done,matrix_size);
+		exit(-1);
+	}
+	if(num_requests>0)
+		printf("Request latency (usecs): avg %ld max %ld\n",total_latency/num_requests,max_latency);
+	printf("Time (usecs): %ld\n",end_t-start_t);
+
+	deallocateCompactMatrix(a,matrix_size);
+	deallocateCompactMatrix(b,matrix_size);
+	deallocateCompactMatrix(c,matrix_size);
+	return 0;
+}
@@ -30,6 +30,8 @@
 #include <algorithm>
 // #define CROSSLANG_RANDOM  // enable the cross-language random generator
 #include "../includes/utils.h"
+#include "../includes/dac_profile.hpp"
+#include "../includes/quicksort_functions.hpp"
 #if USE_FF
 #include <ff/dc.hpp>
 using namespace ff;
@@ -40,99 +42,13 @@ using namespace ff;
 #if USE_TBB
 #include "../includes/dac_tbb.hpp"
 #endif
+#if USE_CORO
+#include "../includes/dac_coro.hpp"
+#endif
+#if USE_SEQUENTIAL
+#include "../includes/dac_sequential.hpp"
+#endif
 using namespace std;
-#define CUTOFF 2000
-
-// Operand (i.e. the Problem) and Results share the same format
-struct ops{
-    int *array=nullptr;          //array to sort
-    int left=0;                     //left index
-    int right=0;                    //right index
-
-};
-
-//for mergesort we have the same type
-typedef struct ops Operand;
-typedef struct ops Result;
-
-
-
-/*
- * The divide chooses as pivot the middle element and redistributes the elements
- */
-void divide(const Operand &op, std::vector<Operand> &ops)
-{
-    ops.push_back(Operand());
-    ops.push_back(Operand());
-
-    int *a=op.array;
-    int pivot=a[(op.left+op.right)/2];
-    int i = op.left-1, j = op.right+1;
-    int tmp;
-
-    while(true)
-    {
-        do{
-            i++;
-        }while(a[i]<pivot);
-        do{
-            j--;
-        }while(a[j]>pivot);
-
-        if(i>=j)
-           break;
-
-        //swap
-        tmp=a[i];
-        a[i]=a[j];
-        a[j]=tmp;
-    }
-
-    //j is the pivot
-
-    ops[0].array=a;
-    ops[0].left=op.left;
-    ops[0].right=j;
-
-    ops[1].array=a;
-    ops[1].left=j+1;
-    ops[1].right=op.right;
-}
-
-
-/*
- * The Combine does nothing
- */
-void mergeQS(vector<Result> &ress, Result &ret)
-{
-    ret.array=ress[0].array;
-    ret.left=ress[0].left;
-    ret.right=ress[1].right;
-}
-
-
-/*
- * Base case: we resort on std::sort
- */
-void seq(const Operand &op, Result &ret)
-{
-
-    std::sort(&(op.array[op.left]),&(op.array[op.right+1]));
-
-	//build result
-    ret.array=op.array;
-    ret.left=op.left;
-    ret.right=op.right;
-}
-
-/*
- * Base case condition
- */
-bool cond(const Operand &op)
-{
-	return (op.right-op.left<=CUTOFF);
-}
-
 int main(int argc, char *argv[])
 {
 	if(argc<2)
@@ -147,6 +63,12 @@ int main(int argc, char *argv[])
 
 	int num_elem=atoi(argv[1]);
 	int nwork=atoi(argv[2]);
+	//replaced by the one tuned for this host (if any)
+	quicksortSettings().cutoff=dacTunedCutoff("quicksort_dac",num_elem,QUICKSORT_CUTOFF,nwork);
+	quicksortSettings().num_sorted=num_elem;
+#if USE_OPENMP || USE_TBB
+	quicksortSettings().partition_workers=nwork;
+#endif
     int seed = argc == 4 ? atoi(argv[3]) : time(0);
     cout << "Parameters:" << endl
          << "   num_elem: " << num_elem << endl
@@ -171,6 +93,18 @@ int main(int argc, char *argv[])
 #if USE_TBB
 	DacTBB<Operand, Result> dac(div,mergef,sq,cf,op,res,nwork);
 #endif
+#if USE_CORO
+	DacCoro<Operand, Result> dac(div,mergef,sq,cf,op,res,nwork);
+#endif
+#if USE_SEQUENTIAL
+	DacSequential<Operand, Result> dac(div,mergef,sq,cf,op,res);
+#endif
+#if USE_OPENMP || USE_TBB || USE_CORO
+	//binary tree: the parent sorts one half itself
+	dac.setSpawnPolicy(DAC_WORK_FIRST);
+	//size reported by the static probes (-DDAC_USDT)
+	dac.setProbeSize([](const Operand &op){ return (long)(op.right-op.left+1); });
+#endif
 
 	long start_t=current_time_usecs();
 
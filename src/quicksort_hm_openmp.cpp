@@ -26,41 +26,23 @@
 #include <functional>
 #include <algorithm>
 #include "../includes/utils.h"
+#include "../includes/quicksort_partition.hpp"
 #include <omp.h>
 using namespace std;
 #define CUTOFF 2000
+int partition_workers;		//tasks of the partition at the root
+long num_sorted;		//length of the array
 
 
 
 /*
- * The divide chooses as pivot the middle element and redistributes the elements
+ * The divide partitions the elements in three (as quicksort_dac): a[lt..gt] are equal to the pivot.
+ * The large ranges are partitioned by parallel tasks, as many as their share of the threads
  */
-int divide(int *a, int left, int right)
+void divide(int *a, int left, int right, int &lt, int &gt)
 {
-    int pivot=a[(left+right)/2];
-    int i = left-1, j = right+1;
-    int tmp;
-
-    while(true)
-    {
-		do{
-			i++;
-		}while(a[i]<pivot);
-		do{
-			j--;
-		}while(a[j]>pivot);
-
-		if(i>=j)
-		   break;
-
-		//swap
-		tmp=a[i];
-		a[i]=a[j];
-		a[j]=tmp;
-    }
-
-    //j is the pivot
-    return j;
+    int segments=partition_workers*(right-left+1L)/num_sorted;
+    quicksortParallelPartition(a,left,right,lt,gt,segments);
 }
 
 
@@ -80,11 +62,12 @@ void quicksort(int *a, int left, int right)
 {
     if(!(right-left<=CUTOFF))
     {
-	int p=divide(a,left,right);
+	int lt, gt;
+	divide(a,left,right,lt,gt);
 #pragma omp task
-	quicksort(a,left,p);
+	quicksort(a,left,lt-1);
 #pragma omp task
-	quicksort(a,p+1,right);
+	quicksort(a,gt+1,right);
 #pragma omp taskwait
     }
     else
@@ -101,6 +84,8 @@ int main(int argc, char *argv[])
 
     int num_elem=atoi(argv[1]);
     int nwork=atoi(argv[2]);
+    partition_workers=nwork;
+    num_sorted=num_elem;
     auto *numbers=generateRandomArray<int>(num_elem);
 
     //build the operand
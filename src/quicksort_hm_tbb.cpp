@@ -29,8 +29,11 @@
 #include <tbb/task.h>
 
 #include "../includes/utils.h"
+#include "../includes/quicksort_partition.hpp"
 using namespace std;
 #define CUTOFF 2000
+int partition_workers;		//tasks of the partition at the root
+long num_sorted;		//length of the array
 
 
 
@@ -52,14 +55,15 @@ private:
     {
 		if(!(_right-_left<=CUTOFF))
 		{
-			int p=divide();
+			int lt, gt;
+			divide(lt,gt);
 
 			//spawn the tasks
 			this->set_ref_count(3);
-			tbb::task *t =new (allocate_child()) QuickSort(_array, _left,p);
+			tbb::task *t =new (allocate_child()) QuickSort(_array, _left,lt-1);
 			spawn(*t);
 
-			tbb::task *t2 =new (allocate_child()) QuickSort(_array, p+1,_right);
+			tbb::task *t2 =new (allocate_child()) QuickSort(_array, gt+1,_right);
 			spawn_and_wait_for_all(*t2);
 
 		}
@@ -71,34 +75,13 @@ private:
 
 
     /*
-     * The divide chooses as pivot the middle element and redistributes the elements
+     * The divide partitions the elements in three (as quicksort_dac): _array[lt..gt] are equal to the pivot.
+     * The large ranges are partitioned by parallel tasks, as many as their share of the threads
      */
-	int divide()
+	void divide(int &lt, int &gt)
     {
-		int pivot=_array[(_left+_right)/2];
-		int i = _left-1, j = _right+1;
-		int tmp;
-
-		while(true)
-		{
-			do{
-				i++;
-			}while(_array[i]<pivot);
-			do{
-				j--;
-			}while(_array[j]>pivot);
-
-			if(i>=j)
-			   break;
-
-			//swap
-			tmp=_array[i];
-			_array[i]=_array[j];
-			_array[j]=tmp;
-		}
-
-		//j is the pivot
-		return j;
+		int segments=partition_workers*(_right-_left+1L)/num_sorted;
+		quicksortParallelPartition(_array,_left,_right,lt,gt,segments);
     }
 
 
@@ -129,6 +112,8 @@ int main(int argc, char *argv[])
 
     int num_elem=atoi(argv[1]);
     int nwork=atoi(argv[2]);
+    partition_workers=nwork;
+    num_sorted=num_elem;
     auto *numbers=generateRandomArray<int>(num_elem);
 
     tbb::task_scheduler_init _task_scheduler(nwork);		//needed to set par degree
@@ -0,0 +1,114 @@
+/* ***************************************************************************
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ *  License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ ****************************************************************************
+
+
+ Sort stream: sorts a stream of independent arrays (batches) with a farm of quicksort DAC computations.
+ Several batches are sorted at the same time on the same workers, so that the sequential phases
+ at the top of each tree are overlapped.
+*/
+
+#include <iostream>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include "../includes/utils.h"
+#include "../includes/dac_farm.hpp"
+#include "../includes/dac_profile.hpp"
+#include "../includes/quicksort_functions.hpp"
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+	if(argc<5)
+	{
+		cerr << "Usage: "<<argv[0]<< " <num_batches> <batch_size> <num_workers> <max_inflight> [<ordered (0|1)>]"<<endl;
+		exit(-1);
+	}
+	std::function<void(const Operand &,vector<Operand> &)> div(divide);
+	std::function <void(const Operand &,Result &)> sq(seq);
+	std::function <void(vector<Result >&,Result &)> mergef(mergeQS);
+	std::function<bool(const Operand &)> cf(cond);
+
+	int num_batches=atoi(argv[1]);
+	int batch_size=atoi(argv[2]);
+	int nwork=atoi(argv[3]);
+	int max_inflight=atoi(argv[4]);
+	bool ordered=(argc>5)?atoi(argv[5])!=0:false;
+
+	//the batches are sorted as quicksort_dac does: cutoff tuned for the batch size (if any), and
+	//each batch partitioned by its share of the workers
+	quicksortSettings().cutoff=dacTunedCutoff("quicksort_dac",batch_size,QUICKSORT_CUTOFF,nwork);
+	quicksortSettings().num_sorted=batch_size;
+	quicksortSettings().partition_workers=std::max(1,nwork/std::max(1,max_inflight));
+
+	typedef DacFarm<Operand,Result>::Problem Problem;
+	DacQueue<Problem> input;
+	DacQueue<Problem> output;
+
+	//generate the batches in advance (the generator is not thread safe)
+	vector<Operand> batches(num_batches);
+	vector<Result> results(num_batches);
+	for(int i=0;i<num_batches;i++)
+	{
+		batches[i].array=generateRandomArray<int>(batch_size,i);
+		batches[i].left=0;
+		batches[i].right=batch_size-1;
+	}
+
+	DacFarm<Operand,Result> farm(div,mergef,sq,cf,input,output,nwork,max_inflight,ordered);
+
+	long start_t=current_time_usecs();
+
+	std::thread farm_thread([&farm]{farm.compute();});
+	//producer: batches arrive one after the other
+	std::thread producer([&]{
+		for(int i=0;i<num_batches;i++)
+			input.push(Problem(&batches[i],&results[i]));
+		input.close();
+	});
+
+	//consumer: check the batches as soon as they are delivered
+	Problem p;
+	int received=0;
+	bool in_order=true;
+	while(output.pop(p))
+	{
+		if(!isArraySorted(p.first->array,batch_size))
+		{
+			fprintf(stderr,"Error: batch is not sorted!!\n");
+			exit(-1);
+		}
+		if(p.first!=&batches[received])
+			in_order=false;
+		received++;
+	}
+	long end_t=current_time_usecs();
+	producer.join();
+	farm_thread.join();
+
+	if(received!=num_batches || (ordered && !in_order))
+	{
+		fprintf(stderr,"Error: received %d batches out of %d%s\n",received,num_batches,(ordered && !in_order)?" (out of order)":"");
+		exit(-1);
+	}
+	printf("Time (usecs): %ld\n",end_t-start_t);
+	printf("Throughput (batches/sec): %.2f\n",num_batches/((end_t-start_t)/1000000.0));
+
+	for(int i=0;i<num_batches;i++)
+		delete[] batches[i].array;
+	return 0;
+}
@@ -39,6 +39,8 @@
 #include <iostream>
 
 #include "../includes/utils.h"
+#include "../includes/dac_profile.hpp"
+#include "../includes/dac_parallel_merge.hpp"
 
 //library taken from intel stable sort implementation
 #include <pss_common.h>
@@ -52,8 +54,18 @@ using namespace ff;
 #if USE_TBB
 #include "../includes/dac_tbb.hpp"
 #endif
+#if USE_CORO
+#include "../includes/dac_coro.hpp"
+#endif
+#if USE_SEQUENTIAL
+#include "../includes/dac_sequential.hpp"
+#endif
 
 #define CUTOFF 500	//same value of Intel source code (INTEL)
+int cutoff=CUTOFF;	//replaced at startup by the one tuned for this host (if any)
+#define MERGE_GRAIN (1<<16)	//minimum length of a segment of a parallel merge
+int merge_workers=1;	//segments of the merge at the root (OpenMP and TBB: the workers)
+long num_sorted;		//length of the array
 
 //---------------------------------------------------------------------
 //Types and definition inherithed by test.cpp in parallel stable sort (INTEL)
@@ -343,10 +355,27 @@ void seq(const Operand &op, Result &ret)
 
 
 /*
- * Merge function: unlike intel source code we perform a serial merge in this phase
+ * Serial merge of a segment (as in intel source code)
+ */
+struct MoveMerge{
+	KeyCompare comp;
+
+	template<typename Iterator1, typename Iterator2, typename Iterator3>
+	void operator()(Iterator1 xs, Iterator1 xe, Iterator2 ys, Iterator2 ye, Iterator3 zs) const
+	{
+		pss::internal::serial_move_merge(xs, xe, ys, ye, zs, comp);
+	}
+};
+
+/*
+ * Merge function: as in intel source code the upper levels, where there are fewer merges than workers,
+ * are merged in parallel (a merge gets the share of the workers proportional to its length)
  */
 void mergeMS(std::vector<Result>&ress, Result &ret)
 {
+	long size=ress[1].end-ress[0].start;
+	int segments=std::min(merge_workers*size/num_sorted,size/MERGE_GRAIN);
+	MoveMerge merge={ress[0].comp};
 	if(ress[0].inplace)
 	{
 		//parallel_move_merge( zs, zm, zm, ze, xs, inplace==2, comp );
@@ -363,7 +392,7 @@ void mergeMS(std::vector<Result>&ress, Result &ret)
 		Iterator zs=ress[0].start;
 		//destroy=inplace
 
-		pss::internal::serial_move_merge(xs, xe, ys, ye, zs, ress[0].comp);
+		dacParallelMerge(xs, xe, ys, ye, zs, ress[0].comp, segments, merge);
 
 		//destroy
 		if(ress[0].inplace==2) //dall'algoritmo originale. In realta' qui non entrera' mai perche' l'inplace dell'operando di partenza (=2) si perde
@@ -386,7 +415,7 @@ void mergeMS(std::vector<Result>&ress, Result &ret)
 		Iterator ye=ress[1].end;
 		//zs=zs(originale)
 		Key *zs=ress[0].temp_buff;
-		pss::internal::serial_move_merge(xs, xe, ys, ye, zs, ress[0].comp);
+		dacParallelMerge(xs, xe, ys, ye, zs, ress[0].comp, segments, merge);
 
 	}
 	//get the final result
@@ -406,7 +435,7 @@ void mergeMS(std::vector<Result>&ress, Result &ret)
  */
 bool cond(const Operand &op)
 {
-	return (op.end-op.start<=CUTOFF);
+	return (op.end-op.start<=cutoff);
 
 
 }
@@ -421,6 +450,11 @@ int main(int argc, char *argv[])
 
 	int n=atoi(argv[1]);
 	int nwork=atoi(argv[2]);
+	cutoff=dacTunedCutoff("stable_mergesort_dac",n,CUTOFF,nwork);
+	num_sorted=n;
+#if USE_OPENMP || USE_TBB
+	merge_workers=nwork;
+#endif
 
 	if(n>N_MAX)
 	{
@@ -467,6 +501,16 @@ int main(int argc, char *argv[])
 #endif
 #if USE_TBB
 	DacTBB<Operand, Result> dac(div,mergef,sq,cf,op,res,nwork);
+#endif
+#if USE_CORO
+	DacCoro<Operand, Result> dac(div,mergef,sq,cf,op,res,nwork);
+#endif
+#if USE_SEQUENTIAL
+	DacSequential<Operand, Result> dac(div,mergef,sq,cf,op,res);
+#endif
+#if USE_OPENMP || USE_TBB || USE_CORO
+	//binary tree: the parent sorts one half itself
+	dac.setSpawnPolicy(DAC_WORK_FIRST);
 #endif
 	//cleanup memory
 	pss::internal::serial_destroy(op.temp_buff,op.temp_buff+n);
@@ -32,6 +32,8 @@
 #include <stdlib.h>
 #include <omp.h>
 #include "../includes/utils.h"
+#include "../includes/dac_profile.hpp"
+#include "../includes/dac_scratch.hpp"
 #if USE_FF
 #include <ff/dc.hpp>
 using namespace ff;
@@ -42,8 +44,15 @@ using namespace ff;
 #if USE_TBB
 #include "../includes/dac_tbb.hpp"
 #endif
+#if USE_CORO
+#include "../includes/dac_coro.hpp"
+#endif
+#if USE_SEQUENTIAL
+#include "../includes/dac_sequential.hpp"
+#endif
 
 #define CUTOFF 128	//matrices CUTOFFxCUTOFF are multiplied with classical algorithm
+int cutoff=CUTOFF;	//replaced at startup by the one tuned for this host (if any)
 using namespace std;
 
 
@@ -52,7 +61,24 @@ using namespace std;
  * Matrices are memorized continuously (in a contiguos memory area).
  * Since we want to reduce memory allocation, when possibile we reuse part of matrices already allocated (by properly setting the row stripe)
  * For the same reason we don't want to delete matrices that will be reused and we have proper flag to set (see the Divide phase)
+ * The origins of a matrix are the top-left corners, in the input matrix, of the blocks it is the sum of:
+ * they tell which nodes have to be recomputed after an update of the input (incremental mode)
+ */
+
+typedef std::vector<std::pair<int,int>> Origins;
+
+/*
+ * Temporary matrices (subproblems and partial results) are recycled by the workers (see dac_scratch.hpp)
  */
+inline double *scratchMatrix(int n)
+{
+	return DacScratch::local().acquire<double>((size_t)n*n);
+}
+
+inline void releaseMatrix(double *m, int n)
+{
+	DacScratch::local().release(m,(size_t)n*n);
+}
 
 struct Operand{
     double *a;        //matrix allocated on contiguos space
@@ -64,6 +90,8 @@ struct Operand{
 
     bool deletable_a=false;
     bool deletable_b=false;
+    Origins a_from;
+    Origins b_from;
 
 
 
@@ -84,6 +112,8 @@ struct Operand{
 		rs_b=op.rs_b;
 		deletable_a=op.deletable_a;
 		deletable_b=op.deletable_b;
+		a_from=std::move(op.a_from);
+		b_from=std::move(op.b_from);
 		//do not delete the original matrix in any case
 		op.deletable_a=false;
 		op.deletable_b=false;
@@ -92,9 +122,9 @@ struct Operand{
     ~Operand()
     {
 		if(deletable_a)
-			deallocateCompactMatrix(this->a,this->a_size);
+			releaseMatrix(this->a,this->a_size);
 		if(deletable_b)
-			deallocateCompactMatrix(this->b,this->b_size);
+			releaseMatrix(this->b,this->b_size);
 
     }
 };
@@ -111,18 +141,18 @@ struct Result{
     Result(int size)
     {
         //simply allocate the space for the matrix
-        c=allocateCompactMatrix(size);
+        c=scratchMatrix(size);
         c_size=size;
         rs_c=size;
     }
 
-	Result()	//needed
+	Result(): c(nullptr), c_size(0), rs_c(0)	//needed
     {}
 
     ~Result()
     {
 
-        deallocateCompactMatrix(this->c,this->c_size);
+        releaseMatrix(this->c,this->c_size);
     }
 
 };
@@ -130,6 +160,24 @@ struct Result{
 typedef struct Operand Operand;
 typedef struct Result Result;
 
+/*
+ * Origins of the (i,j) quadrant of a matrix followed by the ones of the (k,l) quadrant of another
+ */
+Origins quadrants(const Origins &m1, int i, int j, const Origins &m2, int k, int l, int submatrix_size)
+{
+	Origins from;
+	for(const std::pair<int,int> &o:m1)
+		from.push_back({o.first+i*submatrix_size,o.second+j*submatrix_size});
+	for(const std::pair<int,int> &o:m2)
+		from.push_back({o.first+k*submatrix_size,o.second+l*submatrix_size});
+	return from;
+}
+
+Origins quadrant(const Origins &m, int i, int j, int submatrix_size)
+{
+	return quadrants(m,i,j,Origins(),0,0,submatrix_size);
+}
+
 /*
  * Divide function: if possible reuses part of the operand (i.e. submatrices)
  */
@@ -150,36 +198,36 @@ void divide(const Operand &op,std::vector<Operand> &subops)
 
 
     //P1=(a11+a22)(b11+b22)
-    double *p11=allocateCompactMatrix(submatrix_size);
-    double *p12=allocateCompactMatrix(submatrix_size);
+    double *p11=scratchMatrix(submatrix_size);
+    double *p12=scratchMatrix(submatrix_size);
     addCompactMatrix(a11,rs_a,a22,rs_a,p11,submatrix_size,submatrix_size);
     addCompactMatrix(b11,rs_b,b22,rs_b,p12,submatrix_size,submatrix_size);
 
     //P2=(a21+a22)b11
-    double *p21=allocateCompactMatrix(submatrix_size);
+    double *p21=scratchMatrix(submatrix_size);
     addCompactMatrix(a21,rs_a,a22,rs_a,p21,submatrix_size,submatrix_size);
 
     //P3=a11(b12-b22)
-    double *p32=allocateCompactMatrix(submatrix_size);
+    double *p32=scratchMatrix(submatrix_size);
     subtCompactMatrix(b12,rs_b,b22,rs_b,p32,submatrix_size,submatrix_size);
 
     //P4=a22(b21-b11)
-    double *p42=allocateCompactMatrix(submatrix_size);
+    double *p42=scratchMatrix(submatrix_size);
     subtCompactMatrix(b21,rs_b,b11,rs_b,p42,submatrix_size,submatrix_size);
 
     //P5=(a11+a12)b22
-    double *p51=allocateCompactMatrix(submatrix_size);
+    double *p51=scratchMatrix(submatrix_size);
     addCompactMatrix(a11,rs_a,a12,rs_a,p51,submatrix_size,submatrix_size);
 
     //P6=(a21-a11)(b11+b12)
-    double *p61=allocateCompactMatrix(submatrix_size);
-    double *p62=allocateCompactMatrix(submatrix_size);
+    double *p61=scratchMatrix(submatrix_size);
+    double *p62=scratchMatrix(submatrix_size);
     subtCompactMatrix(a21,rs_a,a11,rs_a,p61,submatrix_size,submatrix_size);
     addCompactMatrix(b11,rs_b,b12,rs_b,p62,submatrix_size,submatrix_size);
 
     //P7=(a12-a22)(b21+b22)
-    double *p71=allocateCompactMatrix(submatrix_size);
-    double *p72=allocateCompactMatrix(submatrix_size);
+    double *p71=scratchMatrix(submatrix_size);
+    double *p72=scratchMatrix(submatrix_size);
     subtCompactMatrix(a12,rs_a,a22,rs_a,p71,submatrix_size,submatrix_size);
     addCompactMatrix(b21,rs_b,b22,rs_b,p72,submatrix_size,submatrix_size);
 
@@ -199,6 +247,17 @@ void divide(const Operand &op,std::vector<Operand> &subops)
 
 	subops.push_back(Operand(p71,submatrix_size,submatrix_size,p72,submatrix_size,submatrix_size,true,true));
 
+	//origins of the operands in the input matrices
+	const Origins &a=op.a_from, &b=op.b_from;
+	int h=submatrix_size;
+	subops[0].a_from=quadrants(a,0,0,a,1,1,h);	subops[0].b_from=quadrants(b,0,0,b,1,1,h);
+	subops[1].a_from=quadrants(a,1,0,a,1,1,h);	subops[1].b_from=quadrant(b,0,0,h);
+	subops[2].a_from=quadrant(a,0,0,h);			subops[2].b_from=quadrants(b,0,1,b,1,1,h);
+	subops[3].a_from=quadrant(a,1,1,h);			subops[3].b_from=quadrants(b,1,0,b,0,0,h);
+	subops[4].a_from=quadrants(a,0,0,a,0,1,h);	subops[4].b_from=quadrant(b,1,1,h);
+	subops[5].a_from=quadrants(a,1,0,a,0,0,h);	subops[5].b_from=quadrants(b,0,0,b,0,1,h);
+	subops[6].a_from=quadrants(a,0,1,a,1,1,h);	subops[6].b_from=quadrants(b,1,0,b,1,1,h);
+
 }
 
 
@@ -208,8 +267,9 @@ void divide(const Operand &op,std::vector<Operand> &subops)
 void combineF(vector<Result>&ress, Result &ret)
 {
 	int submatrix_size=ress[0].c_size;
-    //allocate the space for the result
-    ret.c=allocateCompactMatrix(submatrix_size*2);
+    //allocate the space for the result (releasing the one of a previous run, in incremental mode)
+    releaseMatrix(ret.c,ret.c_size);
+    ret.c=scratchMatrix(submatrix_size*2);
     ret.c_size=submatrix_size*2;
     ret.rs_c=submatrix_size*2;
     for(int i=0;i<submatrix_size;i++)
@@ -231,29 +291,135 @@ void combineF(vector<Result>&ress, Result &ret)
 
 
 /*
- * Base case: classical algorithm
+ * Partial combine: the four quadrants of C are computed as soon as the products they use are ready
+ */
+void initCombine(const Operand &op, Result &ret)
+{
+	releaseMatrix(ret.c,ret.c_size);
+	ret.c=scratchMatrix(op.a_size);
+	ret.c_size=op.a_size;
+	ret.rs_c=op.a_size;
+}
+
+//c11=p1+p4-p5+p7
+void combineC11(vector<Result>&ress, Result &ret)
+{
+	int submatrix_size=ress[0].c_size;
+	for(int i=0;i<submatrix_size;i++)
+		for(int j=0;j<submatrix_size;j++)
+			ret.c[i*ret.rs_c+j] = ress[0].c[i*submatrix_size+j]+ress[3].c[i*submatrix_size+j]-ress[4].c[i*submatrix_size+j]+ress[6].c[i*submatrix_size+j];
+}
+
+//c12=p3+p5
+void combineC12(vector<Result>&ress, Result &ret)
+{
+	int submatrix_size=ress[2].c_size;
+	for(int i=0;i<submatrix_size;i++)
+		for(int j=0;j<submatrix_size;j++)
+			ret.c[i*ret.rs_c+j + submatrix_size]=ress[2].c[i*submatrix_size+j]+ress[4].c[i*submatrix_size+j];
+}
+
+//c21=p2+p4
+void combineC21(vector<Result>&ress, Result &ret)
+{
+	int submatrix_size=ress[1].c_size;
+	for(int i=0;i<submatrix_size;i++)
+		for(int j=0;j<submatrix_size;j++)
+			ret.c[(i + submatrix_size)*ret.rs_c+j] = ress[1].c[i*submatrix_size+j]+ress[3].c[i*submatrix_size+j];
+}
+
+//c22=p1-p2+p3+p6
+void combineC22(vector<Result>&ress, Result &ret)
+{
+	int submatrix_size=ress[0].c_size;
+	for(int i=0;i<submatrix_size;i++)
+		for(int j=0;j<submatrix_size;j++)
+			ret.c[(i + submatrix_size)*ret.rs_c+j + submatrix_size] =ress[0].c[i*submatrix_size+j]-ress[1].c[i*submatrix_size+j]+ress[2].c[i*submatrix_size+j]+ress[5].c[i*submatrix_size+j];
+}
+
+//a product is freed as soon as all the quadrants that use it have been computed
+void releaseProduct(Result &res)
+{
+	releaseMatrix(res.c,res.c_size);
+	res.c=nullptr;
+}
+
+/*
+ * Base case: classical algorithm. B is transposed into a temporary of the call (see dac_scratch.hpp),
+ * so that the inner products read both matrices by rows
  */
 void seq(const Operand &op, Result &ret)
 {
-    ret.c=compactMatmul(op.a,op.rs_a,op.b,op.rs_b,op.a_size);
-    ret.c_size=op.a_size;
-    ret.rs_c=op.a_size;
+    int n=op.a_size;
+    releaseMatrix(ret.c,ret.c_size);
+    ret.c=scratchMatrix(n);
+    DacScratchFrame frame;
+    double *bt=frame.allocate<double>((size_t)n*n);
+    for(int i=0;i<n;i++)
+        for(int j=0;j<n;j++)
+            bt[j*n+i]=op.b[i*op.rs_b+j];
+    for(int i=0;i<n;i++)
+        for(int j=0;j<n;j++)
+        {
+            double c=0;
+            for(int k=0;k<n;k++)
+                c+=op.a[i*op.rs_a+k]*bt[j*n+k];
+            ret.c[i*n+j]=c;
+        }
+    ret.c_size=n;
+    ret.rs_c=n;
 }
 
 bool cond(const Operand& op)
 {
-	return(op.a_size<=CUTOFF);
+	return(op.a_size<=cutoff);
+}
+
+/*
+ * Incremental mode: the block of the input updated by the last change
+ */
+struct Update{
+	bool in_a;		//block of A or of B
+	int row;
+	int col;
+	int size;
+} update;
+
+bool dirty(const Operand &op)
+{
+	const Origins &from=(update.in_a?op.a_from:op.b_from);
+	for(const std::pair<int,int> &o:from)
+	{
+		if(o.first<update.row+update.size && update.row<o.first+op.a_size &&
+		   o.second<update.col+update.size && update.col<o.second+op.a_size)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Memory needed by the temporaries of a node: the 10 submatrices allocated by the divide
+ * and the 7 partial results
+ */
+size_t memEstimate(const Operand &op)
+{
+	size_t submatrix_size=op.a_size/2;
+	return 17*submatrix_size*submatrix_size*sizeof(double);
 }
 
 int main(int argc, char *argv[])
 {
     if(argc<3)
     {
-        cerr << "Usage: "<<argv[0]<< " <matrix_size> <nwork> "<<endl;
+        cerr << "Usage: "<<argv[0]<< " <matrix_size> <nwork> [<mem_budget_MB>] [<updates>] [<repetitions>]"<<endl;
+        cerr << "With updates (OpenMP) the product is updated incrementally after changing, each time, a block of A or B"<<endl;
+        cerr << "With repetitions the product is computed again: with OpenMP the runs after the first one replay its schedule"<<endl;
         exit(-1);
     }
     int matrix_size=atoi(argv[1]);
     int nwork=atoi(argv[2]);
+    cutoff=dacTunedCutoff("strassen_dac",matrix_size,CUTOFF,nwork);
+    int repetitions=(argc>5)?atoi(argv[5]):1;
     if(!isPowerOfTwo(matrix_size))
     {
         cerr << "Size must be a power of two!"<<endl;
@@ -264,6 +430,8 @@ int main(int argc, char *argv[])
     double *a=generateCompactRandomMatrix(matrix_size);
     double *b=generateCompactRandomMatrix(matrix_size);
 	Operand op(a,matrix_size,matrix_size,b,matrix_size,matrix_size,false,false);
+	op.a_from={{0,0}};
+	op.b_from={{0,0}};
     Result res;
 
     //functions
@@ -280,6 +448,40 @@ int main(int argc, char *argv[])
 #if USE_TBB
 	DacTBB<Operand, Result> dac(div,combine,sq,cf,op,res,nwork);
 #endif
+#if USE_CORO
+	DacCoro<Operand, Result> dac(div,combine,sq,cf,op,res,nwork);
+#endif
+#if USE_SEQUENTIAL
+	DacSequential<Operand, Result> dac(div,combine,sq,cf,op,res);
+#endif
+#if USE_OPENMP || USE_TBB || USE_CORO
+	//seven children per node: expose all of them to the other workers at once
+	dac.setSpawnPolicy(DAC_HELP_FIRST);
+	//size reported by the static probes (-DDAC_USDT)
+	dac.setProbeSize([](const Operand &op){ return (long)op.a_size; });
+	//bound the memory used by temporaries: nodes that do not fit are solved depth first
+	long mem_budget=(argc>3)?atol(argv[3]):0;	//MB, 0: no limit
+	if(mem_budget>0)
+	{
+		//the matrices cached by the workers (see scratchMatrix) are part of the budget: at most an eighth of it
+		long budget=mem_budget*1024*1024;
+		DacScratch::setCacheLimit(std::min((long)DacScratch::cacheLimit(),budget/8/nwork));
+		dac.setMemoryBudget(budget-nwork*(long)DacScratch::cacheLimit(),memEstimate);
+	}
+#endif
+#if USE_OPENMP || USE_TBB
+	//each quadrant of C is computed as soon as its products are ready
+	dac.setPartialCombine(initCombine,{{{0,3,4,6},combineC11},{{2,4},combineC12},{{1,3},combineC21},{{0,1,2,5},combineC22}},releaseProduct);
+#endif
+#if USE_OPENMP
+	//retain the tree, to recompute only the products affected by the updates
+	int updates=(argc>4)?atoi(argv[4]):0;
+	dac.setIncremental(updates>0);
+	//products of the same size: the following runs replay the partition of the 49 subtrees of the first one
+	DacSchedule schedule(2);
+	if(repetitions>1)
+		dac.setSchedule(&schedule);
+#endif
 
 	long start_t=current_time_usecs();
 
@@ -291,6 +493,43 @@ int main(int argc, char *argv[])
 #endif
 	long end_t=current_time_usecs();
 
+	//same product again (the operand is not changed by a run)
+	long repeat_t=0;
+	for(int r=1;r<repetitions;r++)
+	{
+		long start_r=current_time_usecs();
+#if USE_FF
+		dac.run_and_wait_end();
+#else
+		dac.compute();
+#endif
+		repeat_t+=current_time_usecs()-start_r;
+	}
+	if(repetitions>1)
+		cout << "Repeated run (msecs): "<<repeat_t/1000.0/(repetitions-1)<<endl;
+
+#if USE_OPENMP
+	//change a block (of the size of the leaves) of A or B and update the product
+	long update_t=0;
+	std::function<bool(const Operand&)> df(dirty);
+	for(int u=0;u<updates;u++)
+	{
+		update.in_a=(u%2==0);
+		update.size=min(cutoff,matrix_size);
+		update.row=(rand()%(matrix_size/update.size))*update.size;
+		update.col=(rand()%(matrix_size/update.size))*update.size;
+		double *m=(update.in_a?a:b);
+		for(int i=update.row;i<update.row+update.size;i++)
+			for(int j=update.col;j<update.col+update.size;j++)
+				m[i*matrix_size+j]=(double)(rand())/((double)(RAND_MAX/MAX_DBL_NUM));
+		long start_u=current_time_usecs();
+		dac.recompute(df);
+		update_t+=current_time_usecs()-start_u;
+	}
+	if(updates>0)
+		cout << "Incremental update (msecs): "<<update_t/1000.0/updates<<endl;
+#endif
+
 #if CHECK
 
 	printf("Check Solution....(this could requires time)\n");
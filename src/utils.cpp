@@ -162,7 +162,12 @@ double *compactMatmul(double *a, int rs_a, double *b, int rs_b, int n)
 {
     //allocate space for the result
     double *c=allocateCompactMatrix(n);
+    compactMatmul(a,rs_a,b,rs_b,c,n);
+    return c;
+}
 
+void compactMatmul(double *a, int rs_a, double *b, int rs_b, double *c, int n)
+{
     for(int i=0;i<n;i++)
     {
         for(int j=0;j<n;j++)
@@ -172,7 +177,6 @@ double *compactMatmul(double *a, int rs_a, double *b, int rs_b, int n)
                 c[i*n+j]+=a[i*rs_a+k]*b[k*rs_b+j];
         }
     }
-    return c;
 }
 
 